@@ -0,0 +1,44 @@
+# Turns the libwacom-style ``.tablet`` files in INPUT_DIR into the TabletModel initializers found in OUTPUT.
+#
+#     cmake -D INPUT_DIR=<dir> -D OUTPUT=<file> -P generate_tablet_models.cmake
+
+file(GLOB TABLET_FILES "${INPUT_DIR}/*.tablet")
+list(SORT TABLET_FILES)
+
+set(TABLET_MODELS "// generated from ${INPUT_DIR}, do not edit\n")
+
+function(read_tablet_key CONTENT KEY OUTPUT_VARIABLE)
+    if ("${CONTENT}" MATCHES "\n${KEY}=([^\n]*)")
+        set(${OUTPUT_VARIABLE} "${CMAKE_MATCH_1}" PARENT_SCOPE)
+    else()
+        set(${OUTPUT_VARIABLE} "" PARENT_SCOPE)
+    endif()
+endfunction()
+
+foreach (TABLET_FILE ${TABLET_FILES})
+    file(READ "${TABLET_FILE}" CONTENT)
+
+    read_tablet_key("${CONTENT}" "Name" NAME)
+    read_tablet_key("${CONTENT}" "DeviceMatch" DEVICE_MATCH)
+    read_tablet_key("${CONTENT}" "MaxX" MAX_X)
+    read_tablet_key("${CONTENT}" "MaxY" MAX_Y)
+    read_tablet_key("${CONTENT}" "Resolution" RESOLUTION)
+    read_tablet_key("${CONTENT}" "PressureLevels" PRESSURE_LEVELS)
+
+    if ("${NAME}" STREQUAL "" OR "${MAX_X}" STREQUAL "" OR "${MAX_Y}" STREQUAL "" OR "${RESOLUTION}" STREQUAL "" OR "${PRESSURE_LEVELS}" STREQUAL "")
+        message(FATAL_ERROR "${TABLET_FILE} is missing one of Name, MaxX, MaxY, Resolution or PressureLevels")
+    endif()
+
+    # DeviceMatch is ';' separated, which makes it a list already
+    foreach (MATCH ${DEVICE_MATCH})
+        if (NOT "${MATCH}" MATCHES "^(usb|bluetooth)\\|([0-9a-fA-F]+)\\|([0-9a-fA-F]+)$")
+            continue()
+        endif()
+
+        string(APPEND TABLET_MODELS "TabletModel { \"${NAME}\", 0x${CMAKE_MATCH_2}, 0x${CMAKE_MATCH_3}, ${MAX_X}, ${MAX_Y}, ${RESOLUTION}, ${PRESSURE_LEVELS} },\n")
+    endforeach()
+endforeach()
+
+file(WRITE "${OUTPUT}.tmp" "${TABLET_MODELS}")
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Region.hpp"
+#include "Stylus.hpp"
+#include "Tablet.hpp"
+#include "Texture.hpp"
+#include "Transform.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+inline constexpr auto CANVAS_LIVE_SEGMENTS = 4096zu; // four vertices each, well within 16 bit indices
+inline constexpr auto CANVAS_MAX_WIDTH = 12.f;
+inline constexpr std::uint32_t CANVAS_INK = 0xff'20'c0'ff; // ABGR, same as imgui's colors
+
+struct CanvasVertex
+{
+    float x, y; // canvas pixels
+};
+
+struct CanvasPoint
+{
+    float x, y;
+    float radius;
+};
+
+// a scratch surface to try the pending pressure curve on. segments are tessellated once, when their samples
+// come in, and kept as they are; once there are too many of them they get rasterized into the texture, so
+// drawing it costs the same no matter how long it's been scribbled on.
+struct PressureCanvas
+{
+    int width, height;
+    AxisInfo pressure;
+    Pressure curve;
+    StylusMapping mapping;
+    std::vector<CanvasVertex> vertices;
+    std::optional<CanvasPoint> last; // tip of the stroke being drawn
+    Texture texture;
+    std::vector<std::uint32_t> pixels;
+    std::optional<Region> dirty; // baked since the last upload
+};
+
+PressureCanvas create_pressure_canvas(int width, int height, AxisInfo const& pressure);
+void destroy_pressure_canvas(PressureCanvas& canvas);
+void clear_pressure_canvas(PressureCanvas& canvas);
+// strokes already on the canvas keep the curve they were drawn with
+void update_canvas_mapping(PressureCanvas& canvas, Region const& area, Pressure const& curve);
+void add_canvas_samples(PressureCanvas& canvas, std::span<StylusSample const> samples);
+// a quad from one point to the next, pushed out by each end's radius so consecutive segments overlap instead
+// of leaving notches where the stroke turns
+std::array<CanvasVertex, 4> get_canvas_segment(CanvasPoint const& from, CanvasPoint const& to);
+// `position`, in tablet units, where the stroke being drawn would continue to
+std::optional<CanvasPoint> get_canvas_tip(PressureCanvas const& canvas, Point const& position);
+void upload_pressure_canvas(PressureCanvas& canvas);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <poll.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// every message is a little endian u32 with the length of the rest, a u8 code and the payload, which is
+// text. requests carry a ControlOp as the code, responses a ControlStatus.
+enum class ControlOp : std::uint8_t { PING, LIST, GET, SET, APPLY_PROFILE, SUBSCRIBE };
+enum class ControlStatus : std::uint8_t { OK, ERROR, EVENT };
+
+inline constexpr auto MAX_CONTROL_MESSAGE = 64zu * 1024;
+
+struct ControlMessage
+{
+    std::uint8_t code;
+    std::string payload;
+};
+
+struct ControlClient
+{
+    int fd;
+    std::vector<std::uint8_t> input;
+    std::vector<std::uint8_t> output;
+    bool subscribed;
+    bool hungUp; // done sending, it still gets the responses to what it sent before it goes
+};
+
+struct ControlServer
+{
+    int listener;
+    std::filesystem::path path;
+    std::vector<ControlClient> clients;
+};
+
+struct ControlRequest
+{
+    int client;
+    ControlOp op;
+    std::string payload;
+};
+
+std::filesystem::path get_control_socket_path();
+void append_control_message(std::vector<std::uint8_t>& buffer, std::uint8_t code, std::string_view payload);
+// takes the first complete message off the front of `buffer`
+std::optional<ControlMessage> take_control_message(std::vector<std::uint8_t>& buffer);
+
+ControlServer open_control_server();
+void close_control_server(ControlServer& server);
+void add_control_pollfds(ControlServer const& server, std::vector<pollfd>& fds);
+std::vector<ControlRequest> receive_control_requests(ControlServer& server, std::span<pollfd const> fds);
+// once the requests are answered: the clients that hung up and have nothing left to receive are let go
+void drop_finished_control_clients(ControlServer& server);
+void send_control_response(ControlServer& server, int client, ControlStatus status, std::string_view payload = {});
+void broadcast_control_event(ControlServer& server, std::string_view event);
+// everything that doesn't need the daemon's own state: listing devices and reading or writing properties
+void handle_control_request(ControlServer& server, ControlRequest const& request);
+
+int run_control_client(std::span<std::string_view const> arguments);
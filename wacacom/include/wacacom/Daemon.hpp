@@ -0,0 +1,5 @@
+#pragma once
+
+#include "Follow.hpp"
+
+int run_daemon(FollowMode follow);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Region.hpp"
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+struct _XDisplay;
+struct GLFWwindow;
+struct ImDrawData;
+
+// partial redraw, for sessions where every pixel that changes is a pixel that goes over the network (VNC, x2go)
+// or gets drawn by the CPU
+
+enum class PartialRedraw { AUTO, ON, OFF };
+
+// the draw lists as they were last put on screen
+struct RetainedFrame;
+
+struct DamageTracker
+{
+    std::shared_ptr<RetainedFrame> retained; // shared only so the imgui types stay out of this header
+    bool valid; // nothing to compare against before the first frame, or once the back buffer was lost
+};
+
+// the framebuffer rectangles, top left origin, where `data` differs from what was retained. `data` is retained
+// in its place. everything when there was nothing to compare against
+std::vector<Region> update_frame_damage(DamageTracker& tracker, ImDrawData const& data, int width, int height);
+
+// GLX_MESA_copy_sub_buffer, which the software GLX of Xvnc and x2go sessions has. a copy leaves the back buffer as it
+// was, so it keeps holding the last frame and only the damage has to be drawn again
+struct DamagePresenter
+{
+    _XDisplay* display;
+    unsigned long drawable;
+    void (*copySubBuffer)(_XDisplay*, unsigned long, int, int, int, int);
+};
+
+// call with the window's context current. nothing when the context isn't GLX or the extension is missing
+std::optional<DamagePresenter> open_damage_presenter(GLFWwindow* window);
+void present_damage(DamagePresenter const& presenter, std::span<Region const> damage, int height);
+
+// llvmpipe and friends, where partial redraw pays off even on a local display
+bool is_software_renderer();
@@ -11,6 +11,7 @@ struct Display
     int id;
     bool primary;
     int width, height;
+    int offsetX, offsetY;
     std::string name;
 };
 
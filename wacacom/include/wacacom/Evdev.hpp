@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Hotplug.hpp"
+#include "Tablet.hpp"
+
+#include <span>
+#include <vector>
+
+struct AxisInfo
+{
+    int minimum, maximum;
+    int resolution;
+};
+
+struct TabletNode
+{
+    Device device;
+    AxisInfo x, y;
+    AxisInfo pressure;
+};
+
+std::vector<TabletNode> probe_tablet_node(InputNode const& node);
+std::vector<TabletNode> discover_tablet_nodes(std::span<InputNode const> nodes);
+float get_physical_size_mm(AxisInfo const& axis);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Display.hpp"
+#include "Tablet.hpp"
+#include "XInput.hpp"
+
+#include <libenum/Enum.hpp>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+ENUM_CLASS(FollowMode, OFF, POINTER, FOCUS);
+
+// everything needed to map the tablet onto one monitor, built up front so a remap is just these writes
+struct MonitorTransform
+{
+    std::string name;
+    Region region;
+    std::vector<PropertyWrite> writes;
+};
+
+struct OutputFollower
+{
+    FollowMode mode;
+    std::vector<MonitorTransform> table;
+    std::optional<size_t> current;
+};
+
+std::vector<MonitorTransform> build_monitor_transforms(std::span<Display const> displays, std::span<Device const> devices);
+std::optional<size_t> find_followed_monitor(OutputFollower const& follower, int x, int y);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Region.hpp"
+#include "Stylus.hpp"
+#include "Texture.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// where on the tablet the pen touched, in a fixed grid of bins over the whole active area so memory doesn't
+// grow with the session
+struct Heatmap
+{
+    AxisInfo x, y;
+    int columns, rows;
+    std::vector<std::uint32_t> bins;
+    std::uint32_t scale; // a power of two at or above the fullest bin, colors are relative to it
+    std::optional<Region> dirty; // bins changed since the last upload
+    bool rescaled;
+};
+
+struct HeatmapTexture
+{
+    Texture texture;
+    std::vector<std::uint32_t> pixels;
+    std::chrono::steady_clock::time_point lastUpload;
+};
+
+Heatmap make_heatmap(AxisInfo const& x, AxisInfo const& y);
+void add_heatmap_samples(Heatmap& heatmap, std::span<StylusSample const> samples);
+
+HeatmapTexture create_heatmap_texture(Heatmap const& heatmap);
+void destroy_heatmap_texture(HeatmapTexture& texture);
+void upload_heatmap(HeatmapTexture& texture, Heatmap& heatmap);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+struct _XDisplay;
+
+struct Hotkey
+{
+    int keycode;
+    unsigned int modifiers;
+};
+
+std::optional<Hotkey> parse_hotkey(_XDisplay* display, std::string_view text);
+void grab_hotkey(_XDisplay* display, Hotkey const& hotkey);
+void ungrab_hotkey(_XDisplay* display, Hotkey const& hotkey);
+bool is_hotkey_event(Hotkey const& hotkey, int keycode, unsigned int state);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Tablet.hpp"
+#include "Uevent.hpp"
+
+#include <libenum/Enum.hpp>
+
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+ENUM_CLASS(HotplugAction, ADDED, REMOVED);
+
+struct InputNode
+{
+    DeviceIdentity identity;
+    std::string name;
+    std::string syspath;
+    std::string node;
+};
+
+struct HotplugEvent
+{
+    HotplugAction action;
+    InputNode node;
+};
+
+struct HotplugMonitor
+{
+    std::jthread thread;
+    std::mutex mutex;
+    std::vector<InputNode> nodes;
+    std::vector<HotplugEvent> events;
+    int notify = -1; // an eventfd, readable while there are events to poll, for callers that sleep in poll themselves
+};
+
+std::vector<InputNode> scan_input_nodes();
+std::optional<HotplugEvent> apply_uevent(std::vector<InputNode>& nodes, Uevent const& uevent);
+void start_hotplug_monitor(HotplugMonitor& monitor);
+std::vector<HotplugEvent> poll_hotplug_events(HotplugMonitor& monitor);
+std::vector<InputNode> get_tracked_nodes(HotplugMonitor& monitor);
+
+// feeds synthetic uevents through apply_uevent, prints each check and returns how many failed
+int run_hotplug_self_test();
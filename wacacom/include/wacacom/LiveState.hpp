@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Stylus.hpp"
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// the segment is the interface, anything that can map shared memory can read it without linking to us.
+// readers check the magic and version before trusting the rest
+inline constexpr std::uint32_t LIVE_STATE_MAGIC = 0x4c434157; // "WACL"
+inline constexpr std::uint32_t LIVE_STATE_VERSION = 1;
+inline constexpr auto LIVE_STATE_HISTORY = 256zu;
+
+struct LiveSample
+{
+    std::int64_t time; // microseconds, CLOCK_REALTIME like evdev
+    std::int32_t x, y;
+    std::int32_t pressure;
+    std::int32_t tiltX, tiltY;
+    std::uint32_t contact;
+};
+
+// `sequence` is odd while the producer is writing, a reader that saw it change while copying copies again.
+// the newest sample is history[(published - 1) % LIVE_STATE_HISTORY]
+struct LiveStateSegment
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    alignas(64) std::atomic<std::uint64_t> sequence;
+    std::uint64_t published;
+    std::array<char, 128> device;
+    AxisInfo x, y;
+    AxisInfo pressure;
+    std::array<LiveSample, LIVE_STATE_HISTORY> history;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+struct LiveStatePublisher
+{
+    int fd;
+    LiveStateSegment* segment;
+    std::string name;
+};
+
+struct LiveStateReader
+{
+    int fd;
+    LiveStateSegment const* segment;
+};
+
+struct LiveSnapshot
+{
+    std::string device;
+    AxisInfo x, y;
+    AxisInfo pressure;
+    std::uint64_t published;
+    std::vector<StylusSample> history; // oldest first
+    std::uint64_t retries; // copies thrown away because the producer was writing
+    bool stale; // the sequence stayed odd for too long, nothing was copied. see is_live_state_abandoned
+};
+
+std::string get_live_state_name();
+
+// the fd is -1 when the segment can't be created or another instance is publishing already
+LiveStatePublisher open_live_state_publisher();
+void close_live_state_publisher(LiveStatePublisher& publisher);
+void set_live_state_device(LiveStatePublisher& publisher, TabletNode const* tablet);
+void publish_live_samples(LiveStatePublisher& publisher, std::span<StylusSample const> samples);
+
+std::optional<LiveStateReader> open_live_state_reader();
+void close_live_state_reader(LiveStateReader& reader);
+LiveSnapshot read_live_state(LiveStateReader const& reader, std::size_t history);
+// whether the publisher is gone, a publisher that died in the middle of a write leaves the sequence odd for good
+bool is_live_state_abandoned(LiveStateReader const& reader);
+
+int run_live_state_viewer();
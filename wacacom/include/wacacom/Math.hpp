@@ -1,11 +1,46 @@
 #pragma once
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
 #include <type_traits>
 
+// integer mappings multiply before they divide, so they need room for the product. two differences of 32 bit
+// values already take 33 bits each
+__extension__ typedef __int128 int128_t;
+
+template <class T>
+using WideInteger = std::conditional_t<sizeof(T) < 4, std::int64_t, int128_t>;
+
+// rounds to the nearest, halves away from zero, instead of truncating towards it
+template <class T>
+constexpr T divide_rounded(T numerator, T denominator)
+{
+    if (denominator < 0)
+    {
+        numerator = -numerator;
+        denominator = -denominator;
+    }
+
+    return numerator >= 0 ? (numerator + denominator / 2) / denominator : -((-numerator + denominator / 2) / denominator);
+}
+
 template <class T>
 constexpr T lmap(T x, T minA, T maxA, T minB, T maxB) requires (std::is_arithmetic_v<T>)
 {
-    return minB + ((x - minA) * (maxB - minB))/(maxA - minA);
+    if constexpr (std::is_integral_v<T>)
+    {
+        using Wide = WideInteger<T>;
+        auto const offset = divide_rounded(static_cast<Wide>(static_cast<Wide>(x) - minA) * (static_cast<Wide>(maxB) - minB), static_cast<Wide>(maxA) - minA);
+        return static_cast<T>(minB + offset);
+    }
+    else
+    {
+        return minB + ((x - minA) * (maxB - minB))/(maxA - minA);
+    }
 }
 
 template <class T>
@@ -14,3 +49,156 @@ constexpr T normalize(T x, T min, T max) requires (std::is_arithmetic_v<T>)
     return (x - min)/(max - min);
 }
 
+// Q16.16, for sub-unit positions that have to come out the same on every machine
+struct Fixed
+{
+    std::int32_t raw;
+
+    static constexpr auto FRACTION_BITS = 16;
+
+    static constexpr Fixed from_int(int value) { return { static_cast<std::int32_t>(value * (1 << FRACTION_BITS)) }; }
+    static constexpr Fixed from_float(float value) { return { static_cast<std::int32_t>(value * (1 << FRACTION_BITS) + (value < 0.f ? -0.5f : 0.5f)) }; }
+    constexpr float to_float() const { return static_cast<float>(raw) / (1 << FRACTION_BITS); }
+
+    bool operator==(Fixed const&) const = default;
+};
+
+// batch versions of the above. the ranges are folded once up front so the loop body is as small as it gets.
+// integers and fixed point come out exactly like the scalar lmap, floats can be a rounding step off from it
+
+// the ranges of an integer mapping, with the product taken in `Wide`
+template <class T, class Wide>
+struct IntegerMapping
+{
+    Wide minA, rangeA;
+    Wide minB, rangeB;
+
+    constexpr T operator()(T x) const { return static_cast<T>(minB + divide_rounded((static_cast<Wide>(x) - minA) * rangeB, rangeA)); }
+};
+
+template <class T, class Wide, class Get, class Set>
+constexpr void lmap_wide(std::size_t size, Get&& get, Set&& set, T minA, T maxA, T minB, T maxB)
+{
+    IntegerMapping<T, Wide> const mapping { minA, static_cast<Wide>(maxA) - minA, minB, static_cast<Wide>(maxB) - minB };
+    for (auto i = 0zu; i < size; i += 1) set(i, mapping(get(i)));
+}
+
+// a 32 bit difference times an output range below 2^30 stays below 2^63, which every screen and tablet range is.
+// only wider ranges pay for the 128 bit product
+template <class T, class Get, class Set>
+constexpr void lmap_integers(std::size_t size, Get&& get, Set&& set, T minA, T maxA, T minB, T maxB)
+{
+    if constexpr (sizeof(T) < 4)
+    {
+        lmap_wide<T, std::int64_t>(size, get, set, minA, maxA, minB, maxB);
+    }
+    else if constexpr (sizeof(T) == 4)
+    {
+        auto const rangeB = static_cast<std::int64_t>(maxB) - minB;
+        auto const fits = rangeB < (std::int64_t { 1 } << 30) && rangeB > -(std::int64_t { 1 } << 30);
+
+        if (fits) lmap_wide<T, std::int64_t>(size, get, set, minA, maxA, minB, maxB);
+        else lmap_wide<T, int128_t>(size, get, set, minA, maxA, minB, maxB);
+    }
+    else
+    {
+        lmap_wide<T, int128_t>(size, get, set, minA, maxA, minB, maxB);
+    }
+}
+
+// x * scale + offset, a vector of lanes at a time. the vector type is the compiler's own, an AVX build gets 8
+// lanes in one instruction and anything else gets them in as many as it needs
+template <class T>
+constexpr void lmap_floats(std::span<T const> xs, std::span<T> xsOut, T scale, T offset)
+{
+    auto i = 0zu;
+
+    if !consteval
+    {
+        typedef T Vector __attribute__((vector_size(32)));
+        auto constexpr LANES = sizeof(Vector) / sizeof(T);
+
+        for (; i + LANES <= xs.size(); i += LANES)
+        {
+            Vector x;
+            std::memcpy(&x, xs.data() + i, sizeof(x));
+            Vector const y = x * scale + offset;
+            std::memcpy(xsOut.data() + i, &y, sizeof(y));
+        }
+    }
+
+    for (; i < xs.size(); i += 1) xsOut[i] = xs[i] * scale + offset;
+}
+
+template <class T>
+constexpr void lmap(std::span<T const> xs, std::span<T> xsOut, T minA, T maxA, T minB, T maxB) requires (std::is_arithmetic_v<T>)
+{
+    assert(xs.size() == xsOut.size() && "SPANS MUST HAVE THE SAME SIZE");
+
+    if constexpr (std::is_integral_v<T>)
+    {
+        auto const get = [&] (std::size_t i) { return xs[i]; };
+        auto const set = [&] (std::size_t i, T x) { xsOut[i] = x; };
+        lmap_integers(xs.size(), get, set, minA, maxA, minB, maxB);
+    }
+    else
+    {
+        auto const scale = (maxB - minB) / (maxA - minA);
+        lmap_floats(xs, xsOut, scale, minB - minA * scale);
+    }
+}
+
+// the raw values map like any other int32_t, as if both ranges were scaled up by 2^16
+constexpr void lmap(std::span<Fixed const> xs, std::span<Fixed> xsOut, Fixed minA, Fixed maxA, Fixed minB, Fixed maxB)
+{
+    assert(xs.size() == xsOut.size() && "SPANS MUST HAVE THE SAME SIZE");
+
+    auto const get = [&] (std::size_t i) { return xs[i].raw; };
+    auto const set = [&] (std::size_t i, std::int32_t raw) { xsOut[i].raw = raw; };
+    lmap_integers(xs.size(), get, set, minA.raw, maxA.raw, minB.raw, maxB.raw);
+}
+
+template <class T>
+constexpr void normalize(std::span<T const> xs, std::span<T> xsOut, T min, T max) requires (std::is_floating_point_v<T>)
+{
+    lmap(xs, xsOut, min, max, T { 0 }, T { 1 });
+}
+
+// checks every batch kernel against the scalar lmap over random points, prints each check and returns how many failed
+int run_math_self_test();
+// times every batch kernel against the scalar loop it replaces over `points` random points
+int run_math_bench(std::size_t points);
+
+static_assert(divide_rounded(7, 2) == 4 && divide_rounded(-7, 2) == -4 && divide_rounded(7, -2) == -4 && divide_rounded(6, 4) == 2);
+
+// two thirds of 100 is 67, truncating would have made it 66
+static_assert(lmap(1, 0, 3, 0, 100) == 33 && lmap(2, 0, 3, 0, 100) == 67 && lmap(-2, 0, 3, 0, 100) == -67);
+static_assert(lmap(5, 0, 10, 100, 0) == 50 && lmap(15200, 0, 15200, 0, 1920) == 1920);
+// the whole range of int onto itself, the product only fits in 128 bits
+static_assert(lmap(std::numeric_limits<int>::max(), std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), std::numeric_limits<int>::min(), std::numeric_limits<int>::max()) == std::numeric_limits<int>::max());
+static_assert(lmap(0.5f, 0.f, 1.f, 0.f, 480.f) == 240.f && normalize(135.f, 0.f, 270.f) == 0.5f);
+
+static_assert(Fixed::from_float(1.5f) == Fixed { 3 << 15 } && Fixed::from_int(-2).to_float() == -2.f);
+
+// the batch kernels in a constant expression, which takes the scalar tail for floats
+static_assert([] {
+    std::int32_t const xs[] { 0, 1, 2, 3, std::numeric_limits<std::int32_t>::max() };
+    std::int32_t out[5] {};
+    lmap<std::int32_t>(xs, out, 0, 3, 0, 100);
+
+    std::int32_t wide[1] {};
+    lmap<std::int32_t>(std::span(xs).last(1), wide, std::numeric_limits<std::int32_t>::min(), std::numeric_limits<std::int32_t>::max(), std::numeric_limits<std::int32_t>::min(), std::numeric_limits<std::int32_t>::max());
+
+    Fixed const fixed[] { Fixed::from_int(1) };
+    Fixed fixedOut[1] {};
+    lmap(std::span(fixed), std::span(fixedOut), Fixed::from_int(0), Fixed::from_int(3), Fixed::from_int(0), Fixed::from_int(1));
+
+    float const floats[] { 0.f, 135.f, 270.f };
+    float floatsOut[3] {};
+    normalize<float>(floats, floatsOut, 0.f, 270.f);
+
+    return out[1] == 33 && out[2] == 67 && out[4] == lmap(xs[4], 0, 3, 0, 100)
+        && wide[0] == std::numeric_limits<std::int32_t>::max()
+        && fixedOut[0].raw == lmap<std::int64_t>(Fixed::from_int(1).raw, 0, Fixed::from_int(3).raw, 0, Fixed::from_int(1).raw)
+        && floatsOut[0] == 0.f && floatsOut[1] == .5f && floatsOut[2] == 1.f;
+}());
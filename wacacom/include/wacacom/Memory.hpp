@@ -0,0 +1,4 @@
+#pragma once
+
+// VmRSS of this process, 0 when /proc isn't there to ask
+long get_resident_memory_kib();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Stylus.hpp"
+#include "Transform.hpp"
+
+#include <libenum/Enum.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+ENUM_CLASS(Prediction, OFF, LINEAR, KALMAN);
+
+// never extrapolated further than this, past it the guess is worse than the lag it hides
+inline constexpr auto MAX_PREDICTION_HORIZON = std::int64_t { 50'000 };
+
+// constant velocity model of one axis, in tablet units and seconds
+struct KalmanAxis
+{
+    double position, velocity;
+    std::array<double, 4> covariance; // row major
+};
+
+// guesses where the pen tip is now from where it was in the last few reports, so ink can be drawn ahead of
+// the samples by however long they took to get to the screen
+struct Predictor
+{
+    Prediction mode;
+    double noise; // measurement variance, in tablet units
+    double acceleration; // process variance, in tablet units per second squared
+    std::optional<StylusSample> last;
+    Point velocity; // units per second, the linear mode's
+    std::array<KalmanAxis, 2> axes;
+};
+
+Predictor make_predictor(Prediction mode, AxisInfo const& axis);
+void reset_predictor(Predictor& predictor);
+void update_predictor(Predictor& predictor, StylusSample const& sample);
+// where the pen should be `horizon` microseconds after the last sample, nothing when off or out of contact
+std::optional<Point> predict_position(Predictor const& predictor, std::int64_t horizon);
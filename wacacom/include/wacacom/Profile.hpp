@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Display.hpp"
+#include "Tablet.hpp"
+#include "Transform.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Profile
+{
+    std::string device;
+    std::string output;
+    Region area;
+    Pressure pressure;
+    bool keepAspect; // the output is narrowed to the aspect ratio of the area, see get_profile_output_region
+    Rotation rotation;
+    Region outputArea; // the part of the output the device maps to, relative to it. empty for all of it
+};
+
+std::filesystem::path get_profiles_path();
+std::optional<Profile> parse_profile(std::string_view line);
+std::string format_profile(Profile const& profile);
+std::vector<Profile> load_profiles();
+void save_profile(Profile const& profile);
+Region get_profile_output_region(Profile const& profile, Display const& display);
+void apply_profile(Device const& device, Profile const& profile);
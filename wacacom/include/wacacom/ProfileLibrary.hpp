@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Display.hpp"
+#include "Profile.hpp"
+#include "XInput.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a set of per-device profiles under a name, e.g. "osu! precision", switched to as a whole
+struct NamedProfile
+{
+    std::string name;
+    std::string hotkey;
+    std::vector<std::string> applications;
+    std::vector<Profile> profiles;
+};
+
+// a named profile resolved against the devices that are plugged in right now, down to the raw property
+// writes, so switching to it is nothing more than sending them
+struct ApplyPlan
+{
+    std::string name;
+    std::vector<PropertyWrite> writes;
+};
+
+std::filesystem::path get_profile_library_path();
+std::vector<NamedProfile> load_profile_library();
+bool is_profile_for_application(NamedProfile const& profile, std::string_view application);
+std::optional<ApplyPlan> compile_apply_plan(NamedProfile const& profile, std::span<Device const> devices, std::span<Display const> displays);
+ApplyPlan diff_apply_plan(ApplyPlan const& plan, std::span<PropertyWrite const> applied);
+bool execute_apply_plan(ApplyPlan const& plan);
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "XInput.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+enum class PropertyType { INTEGER, FLOAT };
+
+// one setting of the driver, as a slice of a format 32 device property, since some properties hold more
+// than one setting
+struct PropertyDescriptor
+{
+    std::string_view label;
+    std::string_view property;
+    std::size_t offset, arity;
+    PropertyType type;
+    double minimum, maximum;
+};
+
+inline constexpr auto UNBOUNDED = std::numeric_limits<double>::max();
+
+inline constexpr PropertyDescriptor AREA_PROPERTY { "Area", "Wacom Tablet Area", 0, 4, PropertyType::INTEGER, -1, std::numeric_limits<int>::max() };
+inline constexpr PropertyDescriptor PRESSURE_CURVE_PROPERTY { "Pressure Curve", "Wacom Pressurecurve", 0, 4, PropertyType::INTEGER, 0, 100 };
+inline constexpr PropertyDescriptor SUPPRESS_PROPERTY { "Suppress", "Wacom Sample and Suppress", 0, 1, PropertyType::INTEGER, 0, 100 };
+inline constexpr PropertyDescriptor RAW_SAMPLE_PROPERTY { "Raw Sample", "Wacom Sample and Suppress", 1, 1, PropertyType::INTEGER, 1, 20 };
+inline constexpr PropertyDescriptor THRESHOLD_PROPERTY { "Pressure Threshold", "Wacom Pressure Threshold", 0, 1, PropertyType::INTEGER, 0, 8191 };
+inline constexpr PropertyDescriptor TRANSFORM_PROPERTY { "Transform", "Coordinate Transformation Matrix", 0, 9, PropertyType::FLOAT, -UNBOUNDED, UNBOUNDED };
+
+inline constexpr std::array DRIVER_PROPERTIES {
+    AREA_PROPERTY,
+    PRESSURE_CURVE_PROPERTY,
+    SUPPRESS_PROPERTY,
+    RAW_SAMPLE_PROPERTY,
+    THRESHOLD_PROPERTY,
+    TRANSFORM_PROPERTY,
+};
+
+// how many values the property holds, as far as the table knows
+constexpr std::size_t get_property_length(std::string_view property)
+{
+    auto length = 0zu;
+    for (auto const& descriptor : DRIVER_PROPERTIES)
+    {
+        if (descriptor.property == property) length = std::max(length, descriptor.offset + descriptor.arity);
+    }
+    return length;
+}
+
+// by label, ignoring case and spaces, so xsetwacom's names ("RawSample", "pressurecurve") work too
+std::optional<PropertyDescriptor> find_property_descriptor(std::string_view name);
+
+template <PropertyDescriptor const& DESCRIPTOR>
+using PropertyValue = std::array<std::conditional_t<DESCRIPTOR.type == PropertyType::FLOAT, float, int>, DESCRIPTOR.arity>;
+
+struct PropertyEntry
+{
+    std::string_view property;
+    unsigned long type;
+    std::vector<long> values;
+    bool dirty;
+};
+
+// the properties of a device as a batch: each one is read once, however many settings it holds, and the
+// changed ones are written back together
+struct PropertySet
+{
+    int deviceId;
+    std::vector<PropertyEntry> entries;
+};
+
+// the ranges in the table hold for any device, some settings are bounded by the device itself
+PropertyDescriptor get_device_property_descriptor(int deviceId, PropertyDescriptor const& descriptor);
+
+PropertySet read_device_properties(int deviceId, std::span<PropertyDescriptor const> descriptors = DRIVER_PROPERTIES);
+std::vector<PropertyWrite> get_property_writes(PropertySet const& set);
+// false when the device went away, the set stays dirty then
+bool write_property_set(PropertySet& set);
+
+// values come out as doubles whatever their type, for code that walks the table
+std::optional<std::vector<double>> get_property_values(PropertySet const& set, PropertyDescriptor const& descriptor);
+void set_property_values(PropertySet& set, PropertyDescriptor const& descriptor, std::span<double const> values);
+
+template <PropertyDescriptor const& DESCRIPTOR>
+std::optional<PropertyValue<DESCRIPTOR>> get_property(PropertySet const& set)
+{
+    auto const values = get_property_values(set, DESCRIPTOR);
+    if (!values) return std::nullopt;
+
+    PropertyValue<DESCRIPTOR> result {};
+    std::ranges::transform(*values, result.begin(), [] (double value) { return static_cast<typename PropertyValue<DESCRIPTOR>::value_type>(value); });
+    return result;
+}
+
+template <PropertyDescriptor const& DESCRIPTOR>
+void set_property(PropertySet& set, PropertyValue<DESCRIPTOR> const& value)
+{
+    std::array<double, DESCRIPTOR.arity> values {};
+    std::ranges::transform(value, values.begin(), [] (auto component) { return static_cast<double>(component); });
+    set_property_values(set, DESCRIPTOR, values);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Stylus.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// what's needed to make sense of the samples without the tablet around
+struct RecordingHeader
+{
+    std::string device;
+    AxisInfo x, y;
+    AxisInfo pressure;
+};
+
+struct RecordingWriter
+{
+    std::ofstream file;
+    std::vector<std::uint8_t> buffer;
+    StylusSample last;
+    std::size_t samples;
+};
+
+struct Recording
+{
+    RecordingHeader header;
+    std::span<std::uint8_t const> data; // the mapped file
+    std::size_t samplesOffset;
+};
+
+struct RecordingCursor
+{
+    std::size_t offset;
+    StylusSample last;
+};
+
+RecordingWriter open_recording_writer(std::filesystem::path const& path, RecordingHeader const& header);
+void write_recording_sample(RecordingWriter& writer, StylusSample const& sample);
+void close_recording_writer(RecordingWriter& writer);
+
+std::optional<Recording> open_recording(std::filesystem::path const& path);
+void close_recording(Recording& recording);
+RecordingCursor get_recording_cursor(Recording const& recording);
+std::optional<StylusSample> read_recording_sample(Recording const& recording, RecordingCursor& cursor);
@@ -4,5 +4,7 @@ struct Region
 {
     int offsetX, offsetY;
     int width, height;
+
+    bool operator==(Region const&) const = default;
 };
 
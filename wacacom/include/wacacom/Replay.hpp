@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+int run_recorder(std::filesystem::path const& path);
+int run_replay(std::filesystem::path const& path, bool realtime);
+// how much of the lag `horizon` microseconds of prediction hides on a recording, and what it costs
+int run_prediction_report(std::filesystem::path const& path, std::int64_t horizon);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Display.hpp"
+#include "Evdev.hpp"
+#include "Tablet.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+struct DeviceState
+{
+    Device device;
+    Region entireArea;
+    Region area;
+    Pressure pressure;
+};
+
+struct ApplicationState
+{
+    std::vector<Display> displays;
+    std::vector<DeviceState> devices;
+    std::vector<TabletNode> tabletNodes; // only filled by live queries, never cached
+};
+
+std::filesystem::path get_state_cache_path();
+std::optional<ApplicationState> load_state_cache();
+void save_state_cache(ApplicationState const& state);
+ApplicationState query_application_state();
+std::optional<DeviceState> find_device_state(ApplicationState const& state, Device const& device);
+bool is_same_device(Device const& a, Device const& b);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Region.hpp"
+#include "Tablet.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct LiveStatePublisher;
+
+// one evdev report of the pen, in the tablet's own units
+struct StylusSample
+{
+    std::int64_t time; // microseconds
+    int x, y;
+    int pressure;
+    int tiltX, tiltY;
+    bool contact;
+
+    bool operator==(StylusSample const&) const = default;
+};
+
+struct StylusReader
+{
+    int fd;
+    bool dropped;
+    StylusSample current;
+};
+
+// reads a node on its own thread, so the GUI picks up whatever came in since the last frame
+struct StylusMonitor
+{
+    std::jthread thread;
+    std::mutex mutex;
+    std::string node;
+    std::vector<StylusSample> samples;
+};
+
+// a sample taken all the way through what the driver would do with it: the area onto the output, and the
+// raw pressure through the curve
+struct MappedSample
+{
+    std::int64_t time;
+    float x, y;
+    float pressure;
+    bool contact;
+};
+
+struct StylusMapping
+{
+    Region area;
+    Region output;
+    std::vector<float> pressureTable; // curved pressure for every raw level
+};
+
+StylusReader open_stylus_reader(std::string const& node);
+void close_stylus_reader(StylusReader& reader);
+std::vector<StylusSample> read_stylus_samples(StylusReader& reader);
+
+// with a publisher, every batch also goes out to the shared segment from the reading thread
+void start_stylus_monitor(StylusMonitor& monitor, std::string const& node, LiveStatePublisher* publisher = nullptr);
+void stop_stylus_monitor(StylusMonitor& monitor);
+std::vector<StylusSample> poll_stylus_samples(StylusMonitor& monitor);
+
+float evaluate_pressure_curve(Pressure const& curve, float pressure);
+StylusMapping make_stylus_mapping(Region const& area, Region const& output, Pressure const& curve, AxisInfo const& pressure);
+MappedSample map_stylus_sample(StylusMapping const& mapping, StylusSample const& sample);
+void map_stylus_samples(StylusMapping const& mapping, std::span<StylusSample const> samples, std::span<MappedSample> samplesOut);
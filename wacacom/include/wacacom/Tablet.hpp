@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Region.hpp"
+#include "Transform.hpp"
 
 #include <ctre.hpp>
 #include <fmt/format.h>
@@ -22,17 +23,26 @@ struct Pressure
     float maxX, maxY;
 };
 
+struct DeviceIdentity
+{
+    int vendor, product;
+    std::string serial;
+
+    bool operator==(DeviceIdentity const&) const = default;
+};
+
 struct Device
 {
     std::string name;
     int id;
     DeviceType type;
+    DeviceIdentity identity;
+    std::string node;
 };
 
 std::vector<Device> get_devices();
 std::vector<Device> get_drawing_devices();
-void set_device_output_from_display_name(Device const& device, std::string_view displayName);
-void set_device_output_from_display_region(Device const& device, Region const& dimension);
+void set_device_output_from_display_region(Device const& device, Region const& dimension, Rotation rotation = Rotation::NONE);
 Pressure get_device_pressure_curve(Device const& device);
 void set_device_pressure_curve(Device const& device, Pressure const& pressure);
 Region get_device_area(Device const& device);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Region.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+struct TabletModel
+{
+    std::string_view name;
+    int vendor, product;
+    int width, height;
+    int resolution;
+    int pressureLevels;
+};
+
+inline constexpr std::array TABLET_MODELS {
+#include "TabletModels.inl"
+};
+
+// open addressing over a table twice the size of the model list, so a lookup is a hash and a probe or two
+inline constexpr auto TABLET_MODEL_SLOTS = std::bit_ceil(TABLET_MODELS.size() * 2);
+
+constexpr size_t get_tablet_model_slot(int vendor, int product)
+{
+    auto const key = (static_cast<std::uint32_t>(vendor) << 16) | static_cast<std::uint32_t>(product);
+    return static_cast<size_t>((key * 2654435761u) >> 8) & (TABLET_MODEL_SLOTS - 1);
+}
+
+inline constexpr auto TABLET_MODEL_TABLE = [] {
+    std::array<int, TABLET_MODEL_SLOTS> table {};
+    table.fill(-1);
+
+    for (auto i = 0zu; i < TABLET_MODELS.size(); i += 1)
+    {
+        auto slot = get_tablet_model_slot(TABLET_MODELS[i].vendor, TABLET_MODELS[i].product);
+        while (table[slot] != -1) slot = (slot + 1) & (TABLET_MODEL_SLOTS - 1);
+        table[slot] = static_cast<int>(i);
+    }
+
+    return table;
+}();
+
+constexpr std::optional<TabletModel> find_tablet_model(int vendor, int product)
+{
+    for (auto slot = get_tablet_model_slot(vendor, product); TABLET_MODEL_TABLE[slot] != -1; slot = (slot + 1) & (TABLET_MODEL_SLOTS - 1))
+    {
+        auto const& model = TABLET_MODELS[static_cast<size_t>(TABLET_MODEL_TABLE[slot])];
+        if (model.vendor == vendor && model.product == product) return model;
+    }
+
+    return std::nullopt;
+}
+
+constexpr Region get_tablet_model_area(TabletModel const& model)
+{
+    return { 0, 0, model.width, model.height };
+}
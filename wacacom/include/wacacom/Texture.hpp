@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Region.hpp"
+
+#include <cstdint>
+#include <span>
+
+// an RGBA8 texture, for whatever the GUI draws from the CPU side
+struct Texture
+{
+    unsigned int id;
+    int width, height;
+};
+
+Texture create_texture(int width, int height);
+void destroy_texture(Texture& texture);
+// `pixels` is the whole image, only `region` of it is sent over
+void update_texture(Texture const& texture, Region const& region, std::span<std::uint32_t const> pixels);
+// counts every update of every texture, a frame can draw the same quads over pixels that changed underneath
+std::uint64_t get_texture_generation();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Stylus.hpp"
+#include "Transform.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+inline constexpr auto TRAIL_CAPACITY = 2048zu;
+inline constexpr auto MAX_TRAIL_VERTICES = 256zu;
+
+struct TrailPoint
+{
+    std::int64_t time;
+    Point position; // tablet units
+    bool contact;
+    bool connected; // to the point before it
+};
+
+// the last stretch of pen motion, overwritten in place once full
+struct PenTrail
+{
+    AxisInfo x, y;
+    std::array<TrailPoint, TRAIL_CAPACITY> points;
+    std::size_t head;
+    std::size_t size;
+};
+
+struct TrailStroke
+{
+    bool contact;
+    std::vector<Point> points;
+};
+
+PenTrail make_pen_trail(AxisInfo const& x, AxisInfo const& y);
+void add_trail_samples(PenTrail& trail, std::span<StylusSample const> samples);
+// whatever is newer than `since`, simplified down to at most MAX_TRAIL_VERTICES points overall
+std::vector<TrailStroke> get_trail_strokes(PenTrail const& trail, std::int64_t since);
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Display.hpp"
+#include "Region.hpp"
+
+#include <libenum/Enum.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <span>
+
+ENUM_CLASS(Rotation, NONE, CW, HALF, CCW);
+
+// the "Coordinate Transformation Matrix" of an input device, row major. it takes the device's normalized
+// coordinates to normalized coordinates over the whole screen (the bounding box of every monitor)
+using TransformMatrix = std::array<float, 9>;
+
+struct Point
+{
+    float x, y;
+};
+
+inline constexpr TransformMatrix IDENTITY_TRANSFORM {
+    1.f, 0.f, 0.f,
+    0.f, 1.f, 0.f,
+    0.f, 0.f, 1.f
+};
+
+constexpr Region get_display_region(Display const& display)
+{
+    return { display.offsetX, display.offsetY, display.width, display.height };
+}
+
+constexpr Region get_screen_region(std::span<Display const> displays)
+{
+    auto right = 0;
+    auto bottom = 0;
+
+    for (auto const& display : displays)
+    {
+        right = std::max(right, display.offsetX + display.width);
+        bottom = std::max(bottom, display.offsetY + display.height);
+    }
+
+    return { 0, 0, right, bottom };
+}
+
+constexpr bool is_inside_region(Region const& region, int x, int y, int margin = 0)
+{
+    return x >= region.offsetX - margin && x < region.offsetX + region.width + margin
+        && y >= region.offsetY - margin && y < region.offsetY + region.height + margin;
+}
+
+// `region` is relative to `bounds`, e.g. a part of a monitor, and comes back in the coordinates `bounds` is in
+constexpr Region get_sub_region(Region const& bounds, Region const& region)
+{
+    return { bounds.offsetX + region.offsetX, bounds.offsetY + region.offsetY, region.width, region.height };
+}
+
+// the largest region centered in `bounds` with the aspect ratio of width:height, so the tablet doesn't get
+// stretched on the way to the screen
+constexpr Region fit_aspect(Region const& bounds, int width, int height)
+{
+    if (width <= 0 || height <= 0) return bounds;
+
+    auto const byWidth = static_cast<long long>(bounds.width) * height;
+    auto const byHeight = static_cast<long long>(bounds.height) * width;
+
+    auto const fittedWidth = byWidth <= byHeight ? bounds.width : static_cast<int>(byHeight / height);
+    auto const fittedHeight = byWidth <= byHeight ? static_cast<int>(byWidth / width) : bounds.height;
+
+    return {
+        bounds.offsetX + (bounds.width - fittedWidth) / 2,
+        bounds.offsetY + (bounds.height - fittedHeight) / 2,
+        fittedWidth, fittedHeight
+    };
+}
+
+constexpr TransformMatrix multiply_transforms(TransformMatrix const& left, TransformMatrix const& right)
+{
+    TransformMatrix result {};
+
+    for (auto row = 0zu; row < 3; row += 1)
+    {
+        for (auto column = 0zu; column < 3; column += 1)
+        {
+            for (auto i = 0zu; i < 3; i += 1) result[row * 3 + column] += left[row * 3 + i] * right[i * 3 + column];
+        }
+    }
+
+    return result;
+}
+
+// turns the device around the center of its area, clockwise being the tablet's top ending up on the right
+constexpr TransformMatrix get_rotation_transform(Rotation rotation)
+{
+    if (rotation == Rotation::CW) return { 0.f, -1.f, 1.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+    if (rotation == Rotation::HALF) return { -1.f, 0.f, 1.f, 0.f, -1.f, 1.f, 0.f, 0.f, 1.f };
+    if (rotation == Rotation::CCW) return { 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f, 0.f, 1.f };
+    return IDENTITY_TRANSFORM;
+}
+
+// a quarter turn either way swaps which side of the area is the long one
+constexpr bool is_quarter_turn(Rotation rotation)
+{
+    return rotation == Rotation::CW || rotation == Rotation::CCW;
+}
+
+// rotates the device and then scales and translates it onto `output`, which is given in screen pixels
+constexpr TransformMatrix get_output_transform(Region const& output, Region const& screen, Rotation rotation = Rotation::NONE)
+{
+    if (screen.width <= 0 || screen.height <= 0) return IDENTITY_TRANSFORM;
+
+    auto const screenWidth = static_cast<float>(screen.width);
+    auto const screenHeight = static_cast<float>(screen.height);
+
+    TransformMatrix const placement {
+        static_cast<float>(output.width) / screenWidth, 0.f, static_cast<float>(output.offsetX - screen.offsetX) / screenWidth,
+        0.f, static_cast<float>(output.height) / screenHeight, static_cast<float>(output.offsetY - screen.offsetY) / screenHeight,
+        0.f, 0.f, 1.f
+    };
+
+    return multiply_transforms(placement, get_rotation_transform(rotation));
+}
+
+constexpr Point transform_point(TransformMatrix const& matrix, Point const& point)
+{
+    return {
+        matrix[0] * point.x + matrix[1] * point.y + matrix[2],
+        matrix[3] * point.x + matrix[4] * point.y + matrix[5]
+    };
+}
+
+// for previews, e.g. where a batch of normalized tablet samples land on the screen
+constexpr void transform_points(TransformMatrix const& matrix, std::span<Point const> points, std::span<Point> pointsOut)
+{
+    assert(points.size() == pointsOut.size() && "POINT SPANS MUST HAVE THE SAME SIZE");
+    std::ranges::transform(points, pointsOut.begin(), [&] (auto&& point) { return transform_point(matrix, point); });
+}
+
+// a 4:3 area on a 16:9 monitor gets pillarboxed, a 2:1 one on a square gets letterboxed
+static_assert(fit_aspect({ 0, 0, 1920, 1080 }, 4, 3) == Region { 240, 0, 1440, 1080 });
+static_assert(fit_aspect({ 1920, 0, 1000, 1000 }, 2, 1) == Region { 1920, 250, 1000, 500 });
+static_assert(fit_aspect({ 0, 0, 1920, 1080 }, 0, 3) == Region { 0, 0, 1920, 1080 });
+
+// the right half of two side by side monitors, and the corners of the device landing on its corners
+static_assert(get_output_transform({ 1920, 0, 1920, 1080 }, { 0, 0, 3840, 1080 }) == TransformMatrix { .5f, 0.f, .5f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f });
+static_assert(get_output_transform({ 0, 0, 1920, 1080 }, { 0, 0, 0, 0 }) == IDENTITY_TRANSFORM);
+static_assert(transform_point(get_output_transform({ 1920, 0, 1920, 1080 }, { 0, 0, 3840, 1080 }), { 0.f, 0.f }).x == .5f);
+static_assert(transform_point(get_output_transform({ 1920, 0, 1920, 1080 }, { 0, 0, 3840, 1080 }), { 1.f, 1.f }).x == 1.f);
+static_assert(transform_point(get_output_transform({ 0, 540, 1920, 540 }, { 0, 0, 1920, 1080 }), { 1.f, 0.f }).y == .5f);
+
+// turned clockwise onto the right monitor, the tablet's top left lands on the monitor's top right and its bottom
+// left on the monitor's top left
+static_assert(get_output_transform({ 1920, 0, 1920, 1080 }, { 0, 0, 3840, 1080 }, Rotation::CW) == TransformMatrix { 0.f, -.5f, 1.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f });
+static_assert(transform_point(get_output_transform({ 1920, 0, 1920, 1080 }, { 0, 0, 3840, 1080 }, Rotation::CW), { 0.f, 0.f }).x == 1.f);
+static_assert(transform_point(get_output_transform({ 1920, 0, 1920, 1080 }, { 0, 0, 3840, 1080 }, Rotation::CW), { 0.f, 1.f }).x == .5f);
+static_assert(transform_point(get_output_transform({ 0, 0, 1920, 1080 }, { 0, 0, 1920, 1080 }, Rotation::HALF), { 0.f, 0.f }).y == 1.f);
+static_assert(multiply_transforms(get_rotation_transform(Rotation::CW), get_rotation_transform(Rotation::CCW)) == IDENTITY_TRANSFORM);
+
+// the middle quarter of the right monitor, an offset sub-region of an offset monitor
+static_assert(get_sub_region({ 1920, 0, 1920, 1080 }, { 480, 270, 960, 540 }) == Region { 2400, 270, 960, 540 });
+static_assert(get_output_transform(get_sub_region({ 1920, 0, 1920, 1080 }, { 480, 270, 960, 540 }), { 0, 0, 3840, 1080 }) == TransformMatrix { .25f, 0.f, .625f, 0.f, .5f, .25f, 0.f, 0.f, 1.f });
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Hotkey.hpp"
+
+#include <optional>
+#include <span>
+#include <string_view>
+
+struct _XDisplay;
+
+inline constexpr std::string_view DEFAULT_TRAY_HOTKEY = "ctrl+alt+w";
+
+// what's left of the GUI while it's hidden: a global hotkey and SIGUSR1, either of which brings it back
+struct TrayWatcher
+{
+    _XDisplay* display;
+    std::optional<Hotkey> hotkey;
+    int signals; // a signalfd for SIGUSR1
+};
+
+// has to be opened before any other thread is started, so they all inherit SIGUSR1 being blocked
+TrayWatcher open_tray_watcher(std::string_view hotkey);
+void close_tray_watcher(TrayWatcher& watcher);
+// drains whatever came in without blocking, returns whether any of it asked for the window
+bool take_show_request(TrayWatcher& watcher);
+// sleeps until the window is asked for, or until one of `wake` turns readable or `timeout` milliseconds passed
+// (-1 for none) so the caller can keep its own work going. returns whether the window was asked for
+bool wait_for_show_request(TrayWatcher& watcher, std::span<int const> wake, int timeout);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Properties.hpp"
+#include "Stylus.hpp"
+#include "Tablet.hpp"
+#include "XInput.hpp"
+
+#include <libenum/Enum.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+ENUM_CLASS(TunerPhase, IDLE, HOVER, STROKES, DONE);
+
+struct TunerCandidate
+{
+    int rawSample;
+    int suppress;
+};
+
+// from no filtering at all to about what the driver would do on a noisy tablet
+inline constexpr std::array TUNER_CANDIDATES {
+    TunerCandidate { 1, 0 }, TunerCandidate { 2, 0 }, TunerCandidate { 4, 0 }, TunerCandidate { 8, 0 },
+    TunerCandidate { 1, 2 }, TunerCandidate { 2, 2 }, TunerCandidate { 4, 2 }, TunerCandidate { 8, 2 },
+    TunerCandidate { 2, 6 }, TunerCandidate { 4, 6 },
+};
+
+struct TunerResult
+{
+    TunerCandidate candidate;
+    double jitter; // millimeters, or tablet units when the resolution isn't known
+    double lag; // milliseconds
+    bool pareto;
+};
+
+// sweeps the driver's smoothing through TUNER_CANDIDATES twice, once while the pen hovers still to see how
+// much noise gets through, and once while it draws to see how far behind the pen the driver ends up. each
+// candidate is measured on what the driver posted right after it was written, against the evdev samples it
+// was made from.
+struct Tuner
+{
+    TunerPhase phase;
+    AxisInfo axis;
+    PropertySet original;
+    PropertySet settings;
+    MotionWatcher watcher;
+    std::vector<TunerResult> results;
+    std::size_t current;
+    std::int64_t settled; // microseconds, anything before this was posted with the previous candidate
+    std::vector<StylusSample> samples;
+    std::vector<RawMotion> motions;
+    std::optional<std::size_t> recommended;
+};
+
+Tuner start_tuner(Device const& device, AxisInfo const& axis);
+void update_tuner(Tuner& tuner, std::span<StylusSample const> samples);
+// puts the settings from before the sweep back
+void stop_tuner(Tuner& tuner);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+
+struct Uevent
+{
+    std::string action;
+    std::string devpath;
+    std::string subsystem;
+    std::map<std::string, std::string> properties;
+};
+
+int open_uevent_socket();
+std::optional<Uevent> parse_uevent(std::span<char const> message);
+std::optional<Uevent> receive_uevent(int socket);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Evdev.hpp"
+#include "Region.hpp"
+#include "Stylus.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+inline constexpr auto USAGE_SKETCH_BINS = 1024zu;
+
+// contact positions folded into a fine histogram per axis, which is all a quantile along one axis needs. it
+// stays the same size however long it's fed, and the error of a quantile is at most a bin (a thousandth of
+// the axis).
+struct UsageSketch
+{
+    AxisInfo x, y;
+    std::array<std::uint64_t, USAGE_SKETCH_BINS> xBins;
+    std::array<std::uint64_t, USAGE_SKETCH_BINS> yBins;
+    std::uint64_t count;
+};
+
+UsageSketch make_usage_sketch(AxisInfo const& x, AxisInfo const& y);
+void add_usage_samples(UsageSketch& sketch, std::span<StylusSample const> samples);
+std::optional<Region> recommend_tablet_area(UsageSketch const& sketch, float coverage, int aspectWidth, int aspectHeight);
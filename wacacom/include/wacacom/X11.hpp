@@ -0,0 +1,16 @@
+#pragma once
+
+// Xlib calls its connection type `Display` and Xutil has a `Region`, which clash with our own structs, so
+// the X headers are only ever pulled in through here, with those typedefs renamed to XDisplay and XRegion.
+// Include last.
+
+#define Display XDisplay
+#define Region XRegion
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XInput.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/Xrandr.h>
+#undef Display
+#undef Region
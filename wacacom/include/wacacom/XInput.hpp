@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Tablet.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+struct _XDisplay;
+
+struct PropertyChange
+{
+    int deviceId;
+    std::optional<Region> area;
+    std::optional<Pressure> pressure;
+};
+
+// a single format 32 property write, with the atoms already resolved so applying it doesn't need a round
+// trip. FLOAT properties carry the bits of each float in the low 32 bits of a value
+struct PropertyWrite
+{
+    int deviceId;
+    unsigned long property;
+    unsigned long type;
+    std::vector<long> values;
+
+    bool operator==(PropertyWrite const&) const = default;
+};
+
+// the raw contents of a format 32 property, floats as their bits like in PropertyWrite
+struct PropertyValues
+{
+    unsigned long type;
+    std::vector<long> values;
+};
+
+struct PropertyWatcher
+{
+    _XDisplay* display;
+    int opcode;
+    unsigned long areaAtom;
+    unsigned long pressureAtom;
+};
+
+// a motion of the device as the driver posted it, after its own filtering, in the device's units
+struct RawMotion
+{
+    std::int64_t time; // microseconds, on the same clock as evdev samples
+    double x, y;
+};
+
+struct MotionWatcher
+{
+    _XDisplay* display;
+    int opcode;
+    double x, y; // events only carry the axes that moved
+};
+
+std::vector<Device> list_xinput_devices();
+
+unsigned long get_property_atom(std::string_view name);
+long encode_float_property(float value);
+float decode_float_property(long value);
+PropertyWrite make_float_write(int deviceId, std::string_view property, std::span<float const> values);
+Region query_screen_region();
+std::optional<double> get_valuator_maximum(int deviceId, int number);
+// both fail, instead of taking the process down, when the device went away
+bool write_device_properties(std::span<PropertyWrite const> writes);
+std::optional<PropertyValues> read_device_property(int deviceId, unsigned long property);
+
+PropertyWatcher open_property_watcher();
+void close_property_watcher(PropertyWatcher& watcher);
+void watch_device_properties(PropertyWatcher& watcher, std::span<Device const> devices);
+std::vector<PropertyChange> poll_property_changes(PropertyWatcher& watcher);
+// the connection, to sleep on in poll. poll_property_changes drains whatever was already read off it
+int get_property_watcher_fd(PropertyWatcher const& watcher);
+
+MotionWatcher open_motion_watcher(int deviceId);
+void close_motion_watcher(MotionWatcher& watcher);
+std::vector<RawMotion> poll_raw_motion(MotionWatcher& watcher);
@@ -41,6 +41,23 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateDeviceObjects();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 
+// (Optional) How vertex/index data gets to the GPU. The default re-specifies both buffers with glBufferData() for every draw list.
+// The streaming modes pack every draw list of a frame into a single upload: either into orphaned buffers written through
+// glMapBufferRange(), or into a ring of persistently mapped buffers (needs GL 4.4 or ARB_buffer_storage, orphaning is used without it).
+// Both need glDrawElementsBaseVertex() (GL 3.2). Call after Init(), returns the mode actually in use.
+enum ImGui_ImplOpenGL3_UploadMode
+{
+    ImGui_ImplOpenGL3_UploadMode_PerList,
+    ImGui_ImplOpenGL3_UploadMode_Orphaned,
+    ImGui_ImplOpenGL3_UploadMode_Persistent,
+};
+IMGUI_IMPL_API ImGui_ImplOpenGL3_UploadMode ImGui_ImplOpenGL3_SetUploadMode(ImGui_ImplOpenGL3_UploadMode mode);
+
+// (Optional) Restrict the following RenderDrawData() calls to these rectangles, leaving the rest of the framebuffer as it is.
+// Rectangles are (min x, min y, max x, max y) in framebuffer pixels with a top-left origin, the space ImDrawCmd::ClipRect is projected into.
+// Every command is drawn once per rectangle it overlaps. Pass a count of 0 to draw everything again.
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetDamageRects(const ImVec4* rects, int count);
+
 // Configuration flags to add in your imconfig file:
 //#define IMGUI_IMPL_OPENGL_ES2     // Enable ES 2 (Auto-detected on Emscripten)
 //#define IMGUI_IMPL_OPENGL_ES3     // Enable ES 3 (Auto-detected on iOS/Android)
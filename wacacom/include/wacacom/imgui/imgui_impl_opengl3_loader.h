@@ -19,6 +19,8 @@
 //
 // Regenerate with:
 //   python3 gl3w_gen.py --output ../imgui/backends/imgui_impl_opengl3_loader.h --ref ../imgui/backends/imgui_impl_opengl3.cpp ./extra_symbols.txt
+// (glBufferStorage, glMapBufferRange, glUnmapBuffer and the fence functions were added by hand for the streaming
+// upload path, pass them in extra_symbols.txt when regenerating)
 //
 // More info:
 //   https://github.com/dearimgui/gl3w_stripped
@@ -271,12 +273,14 @@ typedef void (APIENTRYP PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint *buffer
 typedef void (APIENTRYP PFNGLGENBUFFERSPROC) (GLsizei n, GLuint *buffers);
 typedef void (APIENTRYP PFNGLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
 typedef void (APIENTRYP PFNGLBUFFERSUBDATAPROC) (GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+typedef GLboolean (APIENTRYP PFNGLUNMAPBUFFERPROC) (GLenum target);
 #ifdef GL_GLEXT_PROTOTYPES
 GLAPI void APIENTRY glBindBuffer (GLenum target, GLuint buffer);
 GLAPI void APIENTRY glDeleteBuffers (GLsizei n, const GLuint *buffers);
 GLAPI void APIENTRY glGenBuffers (GLsizei n, GLuint *buffers);
 GLAPI void APIENTRY glBufferData (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
 GLAPI void APIENTRY glBufferSubData (GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+GLAPI GLboolean APIENTRY glUnmapBuffer (GLenum target);
 #endif
 #endif /* GL_VERSION_1_5 */
 #ifndef GL_VERSION_2_0
@@ -363,9 +367,13 @@ typedef khronos_uint16_t GLhalf;
 #define GL_NUM_EXTENSIONS                 0x821D
 #define GL_FRAMEBUFFER_SRGB               0x8DB9
 #define GL_VERTEX_ARRAY_BINDING           0x85B5
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_INVALIDATE_BUFFER_BIT      0x0008
+#define GL_MAP_UNSYNCHRONIZED_BIT         0x0020
 typedef void (APIENTRYP PFNGLGETBOOLEANI_VPROC) (GLenum target, GLuint index, GLboolean *data);
 typedef void (APIENTRYP PFNGLGETINTEGERI_VPROC) (GLenum target, GLuint index, GLint *data);
 typedef const GLubyte *(APIENTRYP PFNGLGETSTRINGIPROC) (GLenum name, GLuint index);
+typedef void *(APIENTRYP PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
 typedef void (APIENTRYP PFNGLBINDVERTEXARRAYPROC) (GLuint array);
 typedef void (APIENTRYP PFNGLDELETEVERTEXARRAYSPROC) (GLsizei n, const GLuint *arrays);
 typedef void (APIENTRYP PFNGLGENVERTEXARRAYSPROC) (GLsizei n, GLuint *arrays);
@@ -387,7 +395,13 @@ typedef khronos_uint64_t GLuint64;
 typedef khronos_int64_t GLint64;
 #define GL_CONTEXT_COMPATIBILITY_PROFILE_BIT 0x00000002
 #define GL_CONTEXT_PROFILE_MASK           0x9126
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_WAIT_FAILED                    0x911D
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
 typedef void (APIENTRYP PFNGLDRAWELEMENTSBASEVERTEXPROC) (GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex);
+typedef GLsync (APIENTRYP PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef void (APIENTRYP PFNGLDELETESYNCPROC) (GLsync sync);
+typedef GLenum (APIENTRYP PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
 typedef void (APIENTRYP PFNGLGETINTEGER64I_VPROC) (GLenum target, GLuint index, GLint64 *data);
 #ifdef GL_GLEXT_PROTOTYPES
 GLAPI void APIENTRY glDrawElementsBaseVertex (GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex);
@@ -408,6 +422,11 @@ typedef void (APIENTRYP PFNGLGETDOUBLEI_VPROC) (GLenum target, GLuint index, GLd
 #ifndef GL_VERSION_4_3
 typedef void (APIENTRY  *GLDEBUGPROC)(GLenum source,GLenum type,GLuint id,GLenum severity,GLsizei length,const GLchar *message,const void *userParam);
 #endif /* GL_VERSION_4_3 */
+#ifndef GL_VERSION_4_4
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#endif /* GL_VERSION_4_4 */
 #ifndef GL_VERSION_4_5
 #define GL_CLIP_ORIGIN                    0x935C
 typedef void (APIENTRYP PFNGLGETTRANSFORMFEEDBACKI_VPROC) (GLuint xfb, GLenum pname, GLuint index, GLint *param);
@@ -478,7 +497,7 @@ GL3W_API GL3WglProc imgl3wGetProcAddress(const char *proc);
 
 /* gl3w internal state */
 union ImGL3WProcs {
-    GL3WglProc ptr[59];
+    GL3WglProc ptr[65];
     struct {
         PFNGLACTIVETEXTUREPROC            ActiveTexture;
         PFNGLATTACHSHADERPROC             AttachShader;
@@ -490,15 +509,18 @@ union ImGL3WProcs {
         PFNGLBLENDEQUATIONSEPARATEPROC    BlendEquationSeparate;
         PFNGLBLENDFUNCSEPARATEPROC        BlendFuncSeparate;
         PFNGLBUFFERDATAPROC               BufferData;
+        PFNGLBUFFERSTORAGEPROC            BufferStorage;
         PFNGLBUFFERSUBDATAPROC            BufferSubData;
         PFNGLCLEARPROC                    Clear;
         PFNGLCLEARCOLORPROC               ClearColor;
+        PFNGLCLIENTWAITSYNCPROC           ClientWaitSync;
         PFNGLCOMPILESHADERPROC            CompileShader;
         PFNGLCREATEPROGRAMPROC            CreateProgram;
         PFNGLCREATESHADERPROC             CreateShader;
         PFNGLDELETEBUFFERSPROC            DeleteBuffers;
         PFNGLDELETEPROGRAMPROC            DeleteProgram;
         PFNGLDELETESHADERPROC             DeleteShader;
+        PFNGLDELETESYNCPROC               DeleteSync;
         PFNGLDELETETEXTURESPROC           DeleteTextures;
         PFNGLDELETEVERTEXARRAYSPROC       DeleteVertexArrays;
         PFNGLDETACHSHADERPROC             DetachShader;
@@ -508,6 +530,7 @@ union ImGL3WProcs {
         PFNGLDRAWELEMENTSBASEVERTEXPROC   DrawElementsBaseVertex;
         PFNGLENABLEPROC                   Enable;
         PFNGLENABLEVERTEXATTRIBARRAYPROC  EnableVertexAttribArray;
+        PFNGLFENCESYNCPROC                FenceSync;
         PFNGLFLUSHPROC                    Flush;
         PFNGLGENBUFFERSPROC               GenBuffers;
         PFNGLGENTEXTURESPROC              GenTextures;
@@ -527,6 +550,7 @@ union ImGL3WProcs {
         PFNGLISENABLEDPROC                IsEnabled;
         PFNGLISPROGRAMPROC                IsProgram;
         PFNGLLINKPROGRAMPROC              LinkProgram;
+        PFNGLMAPBUFFERRANGEPROC           MapBufferRange;
         PFNGLPIXELSTOREIPROC              PixelStorei;
         PFNGLPOLYGONMODEPROC              PolygonMode;
         PFNGLREADPIXELSPROC               ReadPixels;
@@ -536,6 +560,7 @@ union ImGL3WProcs {
         PFNGLTEXPARAMETERIPROC            TexParameteri;
         PFNGLUNIFORM1IPROC                Uniform1i;
         PFNGLUNIFORMMATRIX4FVPROC         UniformMatrix4fv;
+        PFNGLUNMAPBUFFERPROC              UnmapBuffer;
         PFNGLUSEPROGRAMPROC               UseProgram;
         PFNGLVERTEXATTRIBPOINTERPROC      VertexAttribPointer;
         PFNGLVIEWPORTPROC                 Viewport;
@@ -555,15 +580,18 @@ GL3W_API extern union ImGL3WProcs imgl3wProcs;
 #define glBlendEquationSeparate           imgl3wProcs.gl.BlendEquationSeparate
 #define glBlendFuncSeparate               imgl3wProcs.gl.BlendFuncSeparate
 #define glBufferData                      imgl3wProcs.gl.BufferData
+#define glBufferStorage                   imgl3wProcs.gl.BufferStorage
 #define glBufferSubData                   imgl3wProcs.gl.BufferSubData
 #define glClear                           imgl3wProcs.gl.Clear
 #define glClearColor                      imgl3wProcs.gl.ClearColor
+#define glClientWaitSync                  imgl3wProcs.gl.ClientWaitSync
 #define glCompileShader                   imgl3wProcs.gl.CompileShader
 #define glCreateProgram                   imgl3wProcs.gl.CreateProgram
 #define glCreateShader                    imgl3wProcs.gl.CreateShader
 #define glDeleteBuffers                   imgl3wProcs.gl.DeleteBuffers
 #define glDeleteProgram                   imgl3wProcs.gl.DeleteProgram
 #define glDeleteShader                    imgl3wProcs.gl.DeleteShader
+#define glDeleteSync                      imgl3wProcs.gl.DeleteSync
 #define glDeleteTextures                  imgl3wProcs.gl.DeleteTextures
 #define glDeleteVertexArrays              imgl3wProcs.gl.DeleteVertexArrays
 #define glDetachShader                    imgl3wProcs.gl.DetachShader
@@ -573,6 +601,7 @@ GL3W_API extern union ImGL3WProcs imgl3wProcs;
 #define glDrawElementsBaseVertex          imgl3wProcs.gl.DrawElementsBaseVertex
 #define glEnable                          imgl3wProcs.gl.Enable
 #define glEnableVertexAttribArray         imgl3wProcs.gl.EnableVertexAttribArray
+#define glFenceSync                       imgl3wProcs.gl.FenceSync
 #define glFlush                           imgl3wProcs.gl.Flush
 #define glGenBuffers                      imgl3wProcs.gl.GenBuffers
 #define glGenTextures                     imgl3wProcs.gl.GenTextures
@@ -592,6 +621,7 @@ GL3W_API extern union ImGL3WProcs imgl3wProcs;
 #define glIsEnabled                       imgl3wProcs.gl.IsEnabled
 #define glIsProgram                       imgl3wProcs.gl.IsProgram
 #define glLinkProgram                     imgl3wProcs.gl.LinkProgram
+#define glMapBufferRange                  imgl3wProcs.gl.MapBufferRange
 #define glPixelStorei                     imgl3wProcs.gl.PixelStorei
 #define glPolygonMode                     imgl3wProcs.gl.PolygonMode
 #define glReadPixels                      imgl3wProcs.gl.ReadPixels
@@ -601,6 +631,7 @@ GL3W_API extern union ImGL3WProcs imgl3wProcs;
 #define glTexParameteri                   imgl3wProcs.gl.TexParameteri
 #define glUniform1i                       imgl3wProcs.gl.Uniform1i
 #define glUniformMatrix4fv                imgl3wProcs.gl.UniformMatrix4fv
+#define glUnmapBuffer                     imgl3wProcs.gl.UnmapBuffer
 #define glUseProgram                      imgl3wProcs.gl.UseProgram
 #define glVertexAttribPointer             imgl3wProcs.gl.VertexAttribPointer
 #define glViewport                        imgl3wProcs.gl.Viewport
@@ -850,15 +881,18 @@ static const char *proc_names[] = {
     "glBlendEquationSeparate",
     "glBlendFuncSeparate",
     "glBufferData",
+    "glBufferStorage",
     "glBufferSubData",
     "glClear",
     "glClearColor",
+    "glClientWaitSync",
     "glCompileShader",
     "glCreateProgram",
     "glCreateShader",
     "glDeleteBuffers",
     "glDeleteProgram",
     "glDeleteShader",
+    "glDeleteSync",
     "glDeleteTextures",
     "glDeleteVertexArrays",
     "glDetachShader",
@@ -868,6 +902,7 @@ static const char *proc_names[] = {
     "glDrawElementsBaseVertex",
     "glEnable",
     "glEnableVertexAttribArray",
+    "glFenceSync",
     "glFlush",
     "glGenBuffers",
     "glGenTextures",
@@ -887,6 +922,7 @@ static const char *proc_names[] = {
     "glIsEnabled",
     "glIsProgram",
     "glLinkProgram",
+    "glMapBufferRange",
     "glPixelStorei",
     "glPolygonMode",
     "glReadPixels",
@@ -896,6 +932,7 @@ static const char *proc_names[] = {
     "glTexParameteri",
     "glUniform1i",
     "glUniformMatrix4fv",
+    "glUnmapBuffer",
     "glUseProgram",
     "glVertexAttribPointer",
     "glViewport",
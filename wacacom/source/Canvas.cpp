@@ -0,0 +1,171 @@
+#include "Canvas.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <ranges>
+
+PressureCanvas create_pressure_canvas(int width, int height, AxisInfo const& pressure)
+{
+    PressureCanvas canvas {
+        width, height, pressure, {}, {}, {}, {},
+        create_texture(width, height),
+        std::vector<std::uint32_t>(static_cast<size_t>(width * height)),
+        Region { 0, 0, width, height }
+    };
+
+    canvas.vertices.reserve(CANVAS_LIVE_SEGMENTS * 4);
+
+    return canvas;
+}
+
+void destroy_pressure_canvas(PressureCanvas& canvas)
+{
+    destroy_texture(canvas.texture);
+    canvas.pixels.clear();
+    canvas.vertices.clear();
+}
+
+void clear_pressure_canvas(PressureCanvas& canvas)
+{
+    std::ranges::fill(canvas.pixels, 0u);
+    canvas.vertices.clear();
+    canvas.last.reset();
+    canvas.dirty = Region { 0, 0, canvas.width, canvas.height };
+}
+
+void update_canvas_mapping(PressureCanvas& canvas, Region const& area, Pressure const& curve)
+{
+    auto const& current = canvas.curve;
+    auto const sameCurve = current.minX == curve.minX && current.minY == curve.minY && current.maxX == curve.maxX && current.maxY == curve.maxY;
+
+    if (sameCurve && canvas.mapping.area == area && !canvas.mapping.pressureTable.empty()) return;
+
+    canvas.curve = curve;
+    // letterboxed the way Force Proportions maps to a monitor, so a circle drawn on the tablet stays one here too.
+    // the area is the driver's, its far corner where the width and height are
+    auto const output = fit_aspect({ 0, 0, canvas.width, canvas.height }, area.width - area.offsetX, area.height - area.offsetY);
+    canvas.mapping = make_stylus_mapping(area, output, curve, canvas.pressure);
+}
+
+static bool is_inside_quad(std::span<CanvasVertex const> quad, float x, float y)
+{
+    auto positive = false;
+    auto negative = false;
+
+    for (auto i = 0zu; i < quad.size(); i += 1)
+    {
+        auto const& from = quad[i];
+        auto const& to = quad[(i + 1) % quad.size()];
+        auto const side = (to.x - from.x) * (y - from.y) - (to.y - from.y) * (x - from.x);
+
+        positive = positive || side > 0.f;
+        negative = negative || side < 0.f;
+    }
+
+    return !(positive && negative);
+}
+
+// the quads are convex and a few pixels across, testing every pixel center of their bounds is plenty
+static void bake_canvas_segments(PressureCanvas& canvas)
+{
+    if (canvas.vertices.empty()) return;
+
+    // grown from whatever is still waiting to be uploaded
+    auto dirtyLeft = canvas.dirty ? canvas.dirty->offsetX : canvas.width;
+    auto dirtyTop = canvas.dirty ? canvas.dirty->offsetY : canvas.height;
+    auto dirtyRight = canvas.dirty ? canvas.dirty->offsetX + canvas.dirty->width : 0;
+    auto dirtyBottom = canvas.dirty ? canvas.dirty->offsetY + canvas.dirty->height : 0;
+
+    for (auto segment = 0zu; segment < canvas.vertices.size(); segment += 4)
+    {
+        std::span<CanvasVertex const> const quad(canvas.vertices.data() + segment, 4);
+
+        auto const [minX, maxX] = std::ranges::minmax(quad | std::views::transform(&CanvasVertex::x));
+        auto const [minY, maxY] = std::ranges::minmax(quad | std::views::transform(&CanvasVertex::y));
+
+        auto const left = std::clamp(static_cast<int>(std::floor(minX)), 0, canvas.width);
+        auto const top = std::clamp(static_cast<int>(std::floor(minY)), 0, canvas.height);
+        auto const rightEdge = std::clamp(static_cast<int>(std::ceil(maxX)), 0, canvas.width);
+        auto const bottomEdge = std::clamp(static_cast<int>(std::ceil(maxY)), 0, canvas.height);
+
+        for (auto row = top; row < bottomEdge; row += 1)
+        {
+            for (auto column = left; column < rightEdge; column += 1)
+            {
+                if (!is_inside_quad(quad, static_cast<float>(column) + 0.5f, static_cast<float>(row) + 0.5f)) continue;
+                canvas.pixels[static_cast<size_t>(row * canvas.width + column)] = CANVAS_INK;
+            }
+        }
+
+        dirtyLeft = std::min(dirtyLeft, left);
+        dirtyTop = std::min(dirtyTop, top);
+        dirtyRight = std::max(dirtyRight, rightEdge);
+        dirtyBottom = std::max(dirtyBottom, bottomEdge);
+    }
+
+    if (dirtyRight > dirtyLeft && dirtyBottom > dirtyTop) canvas.dirty = Region { dirtyLeft, dirtyTop, dirtyRight - dirtyLeft, dirtyBottom - dirtyTop };
+    canvas.vertices.clear();
+}
+
+std::array<CanvasVertex, 4> get_canvas_segment(CanvasPoint const& from, CanvasPoint const& to)
+{
+    auto const length = std::hypot(to.x - from.x, to.y - from.y);
+    auto const dx = length > 0.f ? (to.x - from.x) / length : 1.f;
+    auto const dy = length > 0.f ? (to.y - from.y) / length : 0.f;
+
+    CanvasVertex const start { from.x - dx * from.radius, from.y - dy * from.radius };
+    CanvasVertex const end { to.x + dx * to.radius, to.y + dy * to.radius };
+
+    return {
+        CanvasVertex { start.x - dy * from.radius, start.y + dx * from.radius },
+        CanvasVertex { end.x - dy * to.radius, end.y + dx * to.radius },
+        CanvasVertex { end.x + dy * to.radius, end.y - dx * to.radius },
+        CanvasVertex { start.x + dy * from.radius, start.y - dx * from.radius }
+    };
+}
+
+static void add_canvas_segment(PressureCanvas& canvas, CanvasPoint const& from, CanvasPoint const& to)
+{
+    std::ranges::copy(get_canvas_segment(from, to), std::back_inserter(canvas.vertices));
+
+    if (canvas.vertices.size() >= CANVAS_LIVE_SEGMENTS * 4) bake_canvas_segments(canvas);
+}
+
+void add_canvas_samples(PressureCanvas& canvas, std::span<StylusSample const> samples)
+{
+    if (canvas.mapping.pressureTable.empty()) return;
+
+    for (auto const& sample : samples)
+    {
+        if (!sample.contact)
+        {
+            canvas.last.reset();
+            continue;
+        }
+
+        auto const mapped = map_stylus_sample(canvas.mapping, sample);
+        CanvasPoint const point { mapped.x, mapped.y, 0.5f + mapped.pressure * CANVAS_MAX_WIDTH / 2.f };
+
+        add_canvas_segment(canvas, canvas.last.value_or(point), point);
+        canvas.last = point;
+    }
+}
+
+std::optional<CanvasPoint> get_canvas_tip(PressureCanvas const& canvas, Point const& position)
+{
+    if (!canvas.last || canvas.mapping.pressureTable.empty()) return std::nullopt;
+
+    StylusSample const sample { 0, static_cast<int>(std::lround(position.x)), static_cast<int>(std::lround(position.y)), 0, 0, 0, true };
+    auto const mapped = map_stylus_sample(canvas.mapping, sample);
+
+    return CanvasPoint { mapped.x, mapped.y, canvas.last->radius };
+}
+
+void upload_pressure_canvas(PressureCanvas& canvas)
+{
+    if (!canvas.dirty) return;
+
+    update_texture(canvas.texture, *canvas.dirty, canvas.pixels);
+    canvas.dirty.reset();
+}
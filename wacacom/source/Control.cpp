@@ -0,0 +1,506 @@
+#include "Control.hpp"
+#include "Properties.hpp"
+#include "XInput.hpp"
+
+#include <fmt/format.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+
+// a subscriber that stopped reading is dropped instead of buffered for forever
+static auto constexpr MAX_CONTROL_BACKLOG = 1024zu * 1024;
+static auto constexpr CONTROL_HEADER_SIZE = 4zu;
+static auto constexpr INVALID_CONTROL_CODE = std::uint8_t { 0xff };
+
+std::filesystem::path get_control_socket_path()
+{
+    if (auto const* runtime = std::getenv("XDG_RUNTIME_DIR"); runtime != nullptr && *runtime != '\0')
+    {
+        return std::filesystem::path(runtime) / "wacacom.sock";
+    }
+
+    return std::filesystem::temp_directory_path() / fmt::format("wacacom-{}.sock", getuid());
+}
+
+void append_control_message(std::vector<std::uint8_t>& buffer, std::uint8_t code, std::string_view payload)
+{
+    auto const length = static_cast<std::uint32_t>(payload.size() + 1);
+
+    for (auto shift = 0u; shift < 32; shift += 8) buffer.push_back(static_cast<std::uint8_t>(length >> shift));
+    buffer.push_back(code);
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+}
+
+static std::optional<std::size_t> peek_control_length(std::span<std::uint8_t const> buffer)
+{
+    if (buffer.size() < CONTROL_HEADER_SIZE) return std::nullopt;
+
+    auto length = 0zu;
+    for (auto i = 0zu; i < CONTROL_HEADER_SIZE; i += 1) length |= static_cast<std::size_t>(buffer[i]) << (i * 8);
+    return length;
+}
+
+std::optional<ControlMessage> take_control_message(std::vector<std::uint8_t>& buffer)
+{
+    auto const length = peek_control_length(buffer);
+    if (!length || buffer.size() < CONTROL_HEADER_SIZE + *length) return std::nullopt;
+
+    ControlMessage message { INVALID_CONTROL_CODE, {} };
+
+    if (*length > 0)
+    {
+        auto const* body = buffer.data() + CONTROL_HEADER_SIZE;
+        message.code = body[0];
+        message.payload.assign(reinterpret_cast<char const*>(body + 1), *length - 1);
+    }
+
+    buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(CONTROL_HEADER_SIZE + *length));
+
+    return message;
+}
+
+static std::optional<sockaddr_un> get_control_address(std::filesystem::path const& path)
+{
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+
+    auto const name = path.string();
+    if (name.size() >= sizeof(address.sun_path)) return std::nullopt;
+    std::ranges::copy(name, address.sun_path);
+
+    return address;
+}
+
+// the listener is -1 when there's no socket to be had, which leaves everything else working
+ControlServer open_control_server()
+{
+    ControlServer server { -1, get_control_socket_path(), {} };
+
+    auto const address = get_control_address(server.path);
+    if (!address) return server;
+
+    // a socket that answers belongs to a running instance, one that doesn't was left behind by a dead one
+    auto const probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    auto const taken = connect(probe, reinterpret_cast<sockaddr const*>(&*address), sizeof(*address)) == 0;
+    close(probe);
+    if (taken) return server;
+
+    unlink(server.path.c_str());
+
+    auto const fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (bind(fd, reinterpret_cast<sockaddr const*>(&*address), sizeof(*address)) != 0 || listen(fd, 16) != 0)
+    {
+        close(fd);
+        return server;
+    }
+
+    chmod(server.path.c_str(), S_IRUSR | S_IWUSR);
+    server.listener = fd;
+
+    return server;
+}
+
+void close_control_server(ControlServer& server)
+{
+    for (auto const& client : server.clients) close(client.fd);
+    server.clients.clear();
+
+    if (server.listener == -1) return;
+
+    close(server.listener);
+    unlink(server.path.c_str());
+    server.listener = -1;
+}
+
+void add_control_pollfds(ControlServer const& server, std::vector<pollfd>& fds)
+{
+    if (server.listener == -1) return;
+
+    fds.push_back({ server.listener, POLLIN, 0 });
+
+    for (auto const& client : server.clients)
+    {
+        // a client that hung up would be readable forever
+        auto const events = (client.hungUp ? 0 : POLLIN) | (client.output.empty() ? 0 : POLLOUT);
+        fds.push_back({ client.fd, static_cast<short>(events), 0 });
+    }
+}
+
+static void drop_control_client(ControlClient& client)
+{
+    close(client.fd);
+    client.fd = -1;
+}
+
+// whatever doesn't fit in the socket right now waits for POLLOUT
+static void flush_control_client(ControlClient& client)
+{
+    while (!client.output.empty())
+    {
+        auto const sent = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if (sent == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+            client.output.clear();
+            drop_control_client(client);
+            return;
+        }
+
+        client.output.erase(client.output.begin(), client.output.begin() + sent);
+    }
+
+    if (client.output.size() > MAX_CONTROL_BACKLOG) drop_control_client(client);
+}
+
+static void read_control_client(ControlClient& client, std::vector<ControlRequest>& requests)
+{
+    std::array<std::uint8_t, 4096> buffer {};
+
+    while (true)
+    {
+        auto const received = recv(client.fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+
+        // a client may shut down its end right after sending, what it sent still counts
+        if (received == 0)
+        {
+            client.hungUp = true;
+            break;
+        }
+
+        if (received == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            drop_control_client(client);
+            return;
+        }
+
+        if (received == -1) break;
+        client.input.insert(client.input.end(), buffer.begin(), buffer.begin() + received);
+    }
+
+    while (auto message = take_control_message(client.input))
+    {
+        requests.push_back({ client.fd, static_cast<ControlOp>(message->code), std::move(message->payload) });
+    }
+
+    if (auto const length = peek_control_length(client.input); length && *length > MAX_CONTROL_MESSAGE)
+    {
+        drop_control_client(client);
+    }
+}
+
+std::vector<ControlRequest> receive_control_requests(ControlServer& server, std::span<pollfd const> fds)
+{
+    std::vector<ControlRequest> requests {};
+    if (server.listener == -1) return requests;
+
+    auto const getEvents = [&] (int fd) {
+        auto const entry = std::ranges::find(fds, fd, &pollfd::fd);
+        return entry != fds.end() ? entry->revents : short { 0 };
+    };
+
+    if (getEvents(server.listener) & POLLIN)
+    {
+        for (int fd; (fd = accept4(server.listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) != -1;)
+        {
+            server.clients.push_back({ fd, {}, {}, false, false });
+        }
+    }
+
+    for (auto& client : server.clients)
+    {
+        auto const events = getEvents(client.fd);
+        if (events & (POLLIN | POLLHUP | POLLERR)) read_control_client(client, requests);
+        if (client.fd != -1 && events & POLLOUT) flush_control_client(client);
+    }
+
+    std::erase_if(server.clients, [] (auto&& client) { return client.fd == -1; });
+    std::erase_if(requests, [&] (auto&& request) { return std::ranges::find(server.clients, request.client, &ControlClient::fd) == server.clients.end(); });
+
+    return requests;
+}
+
+void drop_finished_control_clients(ControlServer& server)
+{
+    for (auto& client : server.clients)
+    {
+        if (client.hungUp && client.output.empty()) drop_control_client(client);
+    }
+
+    std::erase_if(server.clients, [] (auto&& client) { return client.fd == -1; });
+}
+
+void send_control_response(ControlServer& server, int client, ControlStatus status, std::string_view payload)
+{
+    auto const entry = std::ranges::find(server.clients, client, &ControlClient::fd);
+    if (entry == server.clients.end()) return;
+
+    append_control_message(entry->output, static_cast<std::uint8_t>(status), payload);
+    flush_control_client(*entry);
+    std::erase_if(server.clients, [] (auto&& candidate) { return candidate.fd == -1; });
+}
+
+void broadcast_control_event(ControlServer& server, std::string_view event)
+{
+    for (auto& client : server.clients)
+    {
+        if (!client.subscribed) continue;
+        append_control_message(client.output, static_cast<std::uint8_t>(ControlStatus::EVENT), event);
+        flush_control_client(client);
+    }
+
+    std::erase_if(server.clients, [] (auto&& client) { return client.fd == -1; });
+}
+
+// "id\nproperty" for a get, followed by "\nvalues" for a set
+static std::vector<std::string_view> split_lines(std::string_view text)
+{
+    std::vector<std::string_view> lines {};
+
+    for (auto position = 0zu; position <= text.size();)
+    {
+        auto end = text.find('\n', position);
+        if (end == std::string_view::npos) end = text.size();
+        lines.push_back(text.substr(position, end - position));
+        position = end + 1;
+    }
+
+    return lines;
+}
+
+template <class T>
+static std::optional<T> parse_number(std::string_view text)
+{
+    T value {};
+    auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc {} || end != text.data() + text.size()) return std::nullopt;
+    return value;
+}
+
+static std::optional<std::vector<double>> parse_values(std::string_view text)
+{
+    std::vector<double> values {};
+
+    for (auto position = 0zu; position < text.size();)
+    {
+        auto end = text.find(' ', position);
+        if (end == std::string_view::npos) end = text.size();
+
+        if (end > position)
+        {
+            auto const value = parse_number<double>(text.substr(position, end - position));
+            if (!value) return std::nullopt;
+            values.push_back(*value);
+        }
+
+        position = end + 1;
+    }
+
+    return values;
+}
+
+void handle_control_request(ControlServer& server, ControlRequest const& request)
+{
+    auto const respond = [&] (ControlStatus status, std::string_view payload = {}) { send_control_response(server, request.client, status, payload); };
+
+    switch (request.op)
+    {
+    case ControlOp::PING: return respond(ControlStatus::OK);
+    case ControlOp::LIST: {
+        std::string devices {};
+        for (auto const& device : list_xinput_devices()) devices += fmt::format("{}\t{}\t{}\n", device.id, device.type.to_string(), device.name);
+        return respond(ControlStatus::OK, devices);
+    }
+    case ControlOp::GET:
+    case ControlOp::SET: {
+        auto const lines = split_lines(request.payload);
+        auto const deviceId = lines.size() >= 2 ? parse_number<int>(lines[0]) : std::nullopt;
+        auto const descriptor = lines.size() >= 2 ? find_property_descriptor(lines[1]) : std::nullopt;
+
+        if (!deviceId || !descriptor) return respond(ControlStatus::ERROR, "expected a device id and a property");
+
+        auto const bounded = get_device_property_descriptor(*deviceId, *descriptor);
+        auto set = read_device_properties(*deviceId, std::array { bounded });
+        auto const current = get_property_values(set, bounded);
+        if (!current) return respond(ControlStatus::ERROR, fmt::format("device {} has no {}", *deviceId, descriptor->label));
+
+        if (request.op == ControlOp::GET) return respond(ControlStatus::OK, fmt::format("{}", fmt::join(*current, " ")));
+
+        auto const values = lines.size() == 3 ? parse_values(lines[2]) : std::nullopt;
+        if (!values || values->size() != descriptor->arity) return respond(ControlStatus::ERROR, fmt::format("{} takes {} values", descriptor->label, descriptor->arity));
+
+        set_property_values(set, bounded, *values);
+        if (!write_property_set(set)) return respond(ControlStatus::ERROR, fmt::format("could not write {} of device {}", descriptor->label, *deviceId));
+        return respond(ControlStatus::OK);
+    }
+    case ControlOp::SUBSCRIBE: {
+        auto const client = std::ranges::find(server.clients, request.client, &ControlClient::fd);
+        if (client != server.clients.end()) client->subscribed = true;
+        return respond(ControlStatus::OK);
+    }
+    case ControlOp::APPLY_PROFILE: return respond(ControlStatus::ERROR, "profiles can only be applied by the daemon");
+    }
+
+    respond(ControlStatus::ERROR, "unknown request");
+}
+
+static int connect_control()
+{
+    auto const address = get_control_address(get_control_socket_path());
+    if (!address) return -1;
+
+    auto const fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connect(fd, reinterpret_cast<sockaddr const*>(&*address), sizeof(*address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static std::optional<ControlMessage> read_control_message(int fd, std::vector<std::uint8_t>& buffer)
+{
+    std::array<std::uint8_t, 4096> chunk {};
+
+    while (true)
+    {
+        if (auto message = take_control_message(buffer)) return message;
+
+        auto const received = recv(fd, chunk.data(), chunk.size(), 0);
+        if (received == -1 && errno == EINTR) continue;
+        if (received <= 0) return std::nullopt;
+
+        buffer.insert(buffer.end(), chunk.begin(), chunk.begin() + received);
+    }
+}
+
+static std::optional<ControlMessage> call_control(int fd, std::vector<std::uint8_t>& buffer, ControlOp op, std::string_view payload = {})
+{
+    std::vector<std::uint8_t> request {};
+    append_control_message(request, static_cast<std::uint8_t>(op), payload);
+
+    for (auto offset = 0zu; offset < request.size();)
+    {
+        auto const sent = send(fd, request.data() + offset, request.size() - offset, MSG_NOSIGNAL);
+        if (sent == -1 && errno == EINTR) continue;
+        if (sent <= 0) return std::nullopt;
+        offset += static_cast<std::size_t>(sent);
+    }
+
+    return read_control_message(fd, buffer);
+}
+
+// a request's round trip, sorted, so percentiles are just indices
+static void print_latencies(std::string_view name, std::vector<double> latencies)
+{
+    if (latencies.empty()) return;
+
+    std::ranges::sort(latencies);
+    auto const mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / static_cast<double>(latencies.size());
+    auto const at = [&] (double percentile) { return latencies[static_cast<std::size_t>(percentile * static_cast<double>(latencies.size() - 1))]; };
+
+    fmt::print("{:<6} {:>8} requests, mean {:.1f} us, p50 {:.1f} us, p99 {:.1f} us, max {:.1f} us\n", name, latencies.size(), mean, at(0.5), at(0.99), latencies.back());
+}
+
+static int run_control_bench(int fd, std::vector<std::uint8_t>& buffer, std::size_t count)
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto const measure = [&] (ControlOp op, std::string_view payload, std::size_t times) {
+        std::vector<double> latencies {};
+        for (auto i = 0zu; i < times; i += 1)
+        {
+            auto const start = Clock::now();
+            if (!call_control(fd, buffer, op, payload)) break;
+            latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+        return latencies;
+    };
+
+    print_latencies("ping", measure(ControlOp::PING, {}, count));
+
+    // a get goes all the way to the X server and back, so it's measured on fewer requests
+    auto const devices = call_control(fd, buffer, ControlOp::LIST);
+    if (devices && devices->code == static_cast<std::uint8_t>(ControlStatus::OK) && !devices->payload.empty())
+    {
+        auto const id = std::string_view(devices->payload).substr(0, devices->payload.find('\t'));
+        print_latencies("get", measure(ControlOp::GET, fmt::format("{}\nArea", id), std::max(count / 10, 1zu)));
+    }
+
+    return 0;
+}
+
+int run_control_client(std::span<std::string_view const> arguments)
+{
+    if (arguments.empty())
+    {
+        fmt::print(stderr, "usage: wacacom --ctl list | get <id> <property> | set <id> <property> <values...> | apply <profile> | subscribe | ping | bench [count]\n");
+        return 1;
+    }
+
+    auto const fd = connect_control();
+    if (fd == -1)
+    {
+        fmt::print(stderr, "nothing is listening on {}, is the daemon running?\n", get_control_socket_path().string());
+        return 1;
+    }
+
+    std::vector<std::uint8_t> buffer {};
+    auto const command = arguments.front();
+    auto const rest = arguments.subspan(1);
+
+    std::optional<ControlMessage> response {};
+
+    if (command == "bench")
+    {
+        auto const count = rest.empty() ? std::optional(10'000zu) : parse_number<std::size_t>(rest.front());
+        auto const result = run_control_bench(fd, buffer, count.value_or(10'000));
+        close(fd);
+        return result;
+    }
+    else if (command == "list") response = call_control(fd, buffer, ControlOp::LIST);
+    else if (command == "ping") response = call_control(fd, buffer, ControlOp::PING);
+    else if (command == "get" && rest.size() == 2) response = call_control(fd, buffer, ControlOp::GET, fmt::format("{}\n{}", rest[0], rest[1]));
+    else if (command == "set" && rest.size() >= 3) response = call_control(fd, buffer, ControlOp::SET, fmt::format("{}\n{}\n{}", rest[0], rest[1], fmt::join(rest.subspan(2), " ")));
+    else if (command == "apply" && rest.size() == 1) response = call_control(fd, buffer, ControlOp::APPLY_PROFILE, rest[0]);
+    else if (command == "subscribe") response = call_control(fd, buffer, ControlOp::SUBSCRIBE);
+    else
+    {
+        fmt::print(stderr, "unknown command '{}'\n", command);
+        close(fd);
+        return 1;
+    }
+
+    if (!response || response->code != static_cast<std::uint8_t>(ControlStatus::OK))
+    {
+        fmt::print(stderr, "{}\n", response ? response->payload : "the daemon hung up");
+        close(fd);
+        return 1;
+    }
+
+    if (!response->payload.empty()) fmt::print("{}{}", response->payload, response->payload.ends_with('\n') ? "" : "\n");
+
+    // events are printed a line each until the daemon goes away
+    if (command == "subscribe")
+    {
+        while (auto const event = read_control_message(fd, buffer))
+        {
+            fmt::print("{}\n", event->payload);
+            std::fflush(stdout);
+        }
+    }
+
+    close(fd);
+
+    return 0;
+}
@@ -0,0 +1,571 @@
+#include "Control.hpp"
+#include "Daemon.hpp"
+#include "Display.hpp"
+#include "Follow.hpp"
+#include "Hotkey.hpp"
+#include "Memory.hpp"
+#include "Profile.hpp"
+#include "ProfileLibrary.hpp"
+#include "Tablet.hpp"
+#include "Uevent.hpp"
+#include "XInput.hpp"
+
+#include <fmt/format.h>
+#include <fplus/fplus.hpp>
+
+#include <linux/input.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <optional>
+#include <utility>
+
+#include "X11.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// every retry lists the devices through xsetwacom, so they back off from the first to the last interval
+static auto constexpr RETRY_INTERVAL = std::chrono::milliseconds(10);
+static auto constexpr MAX_RETRY_INTERVAL = std::chrono::milliseconds(500);
+static auto constexpr RETRY_TIMEOUT = std::chrono::seconds(3);
+// alt-tabbing through windows shouldn't apply a profile for every one of them, only for where focus lands
+static auto constexpr FOCUS_DEBOUNCE = std::chrono::milliseconds(30);
+
+static volatile std::sig_atomic_t shouldStop = 0;
+
+struct Trigger
+{
+    Clock::time_point time;
+    std::string reason;
+    bool force;
+    std::vector<int> knownIds;
+    Clock::time_point retry; // the first try is right away
+    std::chrono::milliseconds interval;
+};
+
+struct ProfileBinding
+{
+    std::optional<Hotkey> hotkey;
+    NamedProfile profile;
+    std::optional<ApplyPlan> plan;
+};
+
+struct FocusChange
+{
+    Clock::time_point time;
+    Window window;
+};
+
+template <class... Args>
+static void daemon_log(fmt::format_string<Args...> format, Args&&... args)
+{
+    fmt::print(stderr, "[wacacom] {}\n", fmt::format(format, std::forward<Args>(args)...));
+}
+
+static std::vector<int> get_drawing_device_ids()
+{
+    return fplus::transform([] (auto&& device) { return device.id; }, get_drawing_devices());
+}
+
+// only a device with a pen can become a drawing device, plugging in a mouse or a keyboard isn't worth looking for one.
+// the inputN uevent carries the key bitmap, space separated hex words with the most significant first
+static bool is_pen_uevent(Uevent const& uevent)
+{
+    if (uevent.subsystem != "input" || uevent.action != "add" || !uevent.properties.contains("KEY")) return false;
+
+    static auto constexpr LONG_BITS = sizeof(unsigned long) * CHAR_BIT;
+    auto const words = fplus::split(' ', false, uevent.properties.at("KEY"));
+    auto const index = static_cast<size_t>(BTN_TOOL_PEN) / LONG_BITS;
+    if (index >= words.size()) return false;
+
+    auto const word = std::stoul(words[words.size() - 1 - index], nullptr, 16);
+    return (word >> (static_cast<size_t>(BTN_TOOL_PEN) % LONG_BITS)) & 1ul;
+}
+
+static double elapsed_ms(Clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+// applies the stored profile of every device that showed up since the trigger (or of all of them when
+// forced), returns whether any such device was found.
+static bool reapply_profiles(Trigger const& trigger)
+{
+    auto const profiles = load_profiles();
+    auto found = false;
+
+    for (auto const& device : get_drawing_devices())
+    {
+        if (!trigger.force && fplus::is_elem_of(device.id, trigger.knownIds)) continue;
+        found = true;
+
+        auto const profile = fplus::find_first_by([&] (auto&& stored) { return stored.device == device.name; }, profiles);
+        if (profile.is_nothing()) continue;
+
+        apply_profile(device, profile.unsafe_get_just());
+
+        daemon_log("re-applied profile to '{}' (id {}) {:.1f} ms after {}, rss {} KiB",
+            device.name, device.id, elapsed_ms(trigger.time), trigger.reason, get_resident_memory_kib());
+    }
+
+    return found;
+}
+
+// plans hold device ids, so they're compiled again whenever the set of devices may have changed
+static void compile_bindings(std::vector<ProfileBinding>& bindings)
+{
+    auto const devices = get_drawing_devices();
+    auto const displays = list_active_displays();
+
+    for (auto& binding : bindings)
+    {
+        binding.plan = compile_apply_plan(binding.profile, devices, displays);
+        if (!binding.plan) daemon_log("profile '{}' does not fit the connected devices, it is disabled", binding.profile.name);
+    }
+}
+
+static std::vector<ProfileBinding> bind_profile_library(XDisplay* display)
+{
+    std::vector<ProfileBinding> bindings {};
+
+    for (auto& profile : load_profile_library())
+    {
+        std::optional<Hotkey> hotkey {};
+
+        if (!profile.hotkey.empty())
+        {
+            hotkey = parse_hotkey(display, profile.hotkey);
+            if (hotkey) grab_hotkey(display, *hotkey);
+            else daemon_log("could not parse hotkey '{}' of profile '{}'", profile.hotkey, profile.name);
+        }
+
+        bindings.push_back({ hotkey, std::move(profile), std::nullopt });
+    }
+
+    XFlush(display);
+    compile_bindings(bindings);
+
+    return bindings;
+}
+
+// applies only what differs from what went through here before. entries of `applied` go away as soon as something
+// else writes their property, and all of them whenever the devices may have changed
+static void switch_profile(ControlServer& control, ProfileBinding const& binding, std::vector<PropertyWrite>& applied, Clock::time_point since, std::string_view reason)
+{
+    if (!binding.plan) return;
+
+    auto const plan = diff_apply_plan(*binding.plan, applied);
+
+    // a device went away under the plan, which of the writes made it is anyone's guess, so nothing is recorded
+    if (!execute_apply_plan(plan))
+    {
+        daemon_log("could not switch to profile '{}', a device is gone", binding.profile.name);
+        applied.clear();
+        return;
+    }
+
+    daemon_log("switched to profile '{}' ({} of {} writes) {:.2f} ms after {}",
+        binding.profile.name, plan.writes.size(), binding.plan->writes.size(), elapsed_ms(since), reason);
+
+    for (auto const& write : plan.writes)
+    {
+        std::erase_if(applied, [&] (auto&& stored) { return stored.deviceId == write.deviceId && stored.property == write.property; });
+        applied.push_back(write);
+    }
+
+    broadcast_control_event(control, fmt::format("profile {}", binding.profile.name));
+}
+
+// a property event doesn't tell who wrote, so the property is read back: the daemon's own writes still hold what
+// it stored and keep their entry
+static void forget_overwritten_write(std::vector<PropertyWrite>& applied, int deviceId, Atom property)
+{
+    auto const stored = std::ranges::find_if(applied, [&] (auto&& write) { return write.deviceId == deviceId && write.property == property; });
+    if (stored == applied.end()) return;
+
+    auto const current = read_device_property(deviceId, property);
+    if (current && current->type == stored->type && current->values == stored->values) return;
+
+    applied.erase(stored);
+}
+
+// the active window can be gone by the time its class is asked for, which isn't worth dying over. anything else,
+// like a property write to a device that was just unplugged, is worth knowing about
+static int log_x_error(XDisplay* display, XErrorEvent* error)
+{
+    if (error->error_code == BadWindow) return 0;
+
+    std::array<char, 256> text {};
+    XGetErrorText(display, error->error_code, text.data(), static_cast<int>(text.size()));
+    daemon_log("X error: {} (request {}.{})", text.data(), error->request_code, error->minor_code);
+
+    return 0;
+}
+
+static Window get_active_window(XDisplay* display, Atom activeWindowAtom)
+{
+    Atom type {};
+    int format {};
+    unsigned long count {};
+    unsigned long remaining {};
+    unsigned char* data {};
+
+    auto const root = DefaultRootWindow(display);
+    if (XGetWindowProperty(display, root, activeWindowAtom, 0, 1, False, XA_WINDOW, &type, &format, &count, &remaining, &data) != Success) return None;
+
+    Window window = None;
+    if (type == XA_WINDOW && format == 32 && count == 1) window = *reinterpret_cast<Window const*>(data);
+    XFree(data);
+
+    return window;
+}
+
+static std::string get_window_class(XDisplay* display, Window window)
+{
+    XClassHint hint {};
+    if (window == None || !XGetClassHint(display, window, &hint)) return {};
+
+    std::string application(hint.res_class != nullptr ? hint.res_class : "");
+    XFree(hint.res_name);
+    XFree(hint.res_class);
+
+    return application;
+}
+
+static std::optional<std::pair<int, int>> get_window_center(XDisplay* display, Window window)
+{
+    XWindowAttributes attributes {};
+    if (window == None || !XGetWindowAttributes(display, window, &attributes)) return std::nullopt;
+
+    auto x = 0;
+    auto y = 0;
+    Window child = None;
+    XTranslateCoordinates(display, window, DefaultRootWindow(display), attributes.width / 2, attributes.height / 2, &x, &y, &child);
+
+    return std::pair { x, y };
+}
+
+static std::pair<int, int> get_pointer_position(XDisplay* display)
+{
+    Window root = None;
+    Window child = None;
+    auto x = 0;
+    auto y = 0;
+    auto windowX = 0;
+    auto windowY = 0;
+    auto mask = 0u;
+    XQueryPointer(display, DefaultRootWindow(display), &root, &child, &x, &y, &windowX, &windowY, &mask);
+
+    return { x, y };
+}
+
+static void follow_point(ControlServer& control, OutputFollower& follower, int x, int y, Clock::time_point since, std::string_view reason)
+{
+    auto const monitor = find_followed_monitor(follower, x, y);
+    if (!monitor || monitor == follower.current) return;
+
+    // the monitor only becomes the current one once it's written, a failed write is tried again on the next move
+    auto const& transform = follower.table.at(*monitor);
+    if (!write_device_properties(transform.writes))
+    {
+        daemon_log("could not map to '{}', a device is gone", transform.name);
+        return;
+    }
+
+    follower.current = monitor;
+    daemon_log("mapped to '{}' {:.2f} ms after {}", transform.name, elapsed_ms(since), reason);
+    broadcast_control_event(control, fmt::format("output {}", transform.name));
+}
+
+// the table depends on both the monitor layout and the devices, so it's rebuilt when either changes. the
+// current monitor is written again, since re-applying profiles maps the devices to their stored output
+static void rebuild_follower(OutputFollower& follower)
+{
+    if (follower.mode == FollowMode::OFF) return;
+
+    auto const current = follower.current ? follower.table.at(*follower.current).name : std::string {};
+
+    // erasers and touch are devices of their own and have to land on the same monitor as the stylus
+    auto const devices = fplus::drop_if([] (auto&& device) { return device.type == DeviceType::PAD; }, get_devices());
+    follower.table = build_monitor_transforms(list_active_displays(), devices);
+    follower.current.reset();
+
+    auto const monitor = fplus::find_first_idx_by([&] (auto&& transform) { return transform.name == current; }, follower.table);
+    if (monitor.is_nothing()) return;
+
+    follower.current = monitor.unsafe_get_just();
+    write_device_properties(follower.table.at(*follower.current).writes);
+}
+
+// a profile naming the application wins over one that's there for any ('*')
+static ProfileBinding const* find_application_binding(std::vector<ProfileBinding> const& bindings, std::string_view application)
+{
+    auto const find = [&] (std::string_view pattern) {
+        return std::ranges::find_if(bindings, [&] (auto&& candidate) { return is_profile_for_application(candidate.profile, pattern); });
+    };
+
+    auto binding = find(application);
+    if (binding == bindings.end()) binding = find("*");
+
+    return binding != bindings.end() ? &*binding : nullptr;
+}
+
+int run_daemon(FollowMode follow)
+{
+    std::signal(SIGINT, [] (int) { shouldStop = 1; });
+    std::signal(SIGTERM, [] (int) { shouldStop = 1; });
+
+    auto const uevents = open_uevent_socket();
+
+    auto* display = XOpenDisplay(nullptr);
+    assert(display && "COULD NOT OPEN X DISPLAY");
+
+    auto randrEventBase = 0;
+    auto randrErrorBase = 0;
+    if (XRRQueryExtension(display, &randrEventBase, &randrErrorBase))
+    {
+        XRRSelectInput(display, DefaultRootWindow(display), RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    }
+    else
+    {
+        daemon_log("XRandR is unavailable, output changes will not be tracked");
+    }
+
+    XSetErrorHandler(log_x_error);
+
+    auto const activeWindowAtom = XInternAtom(display, "_NET_ACTIVE_WINDOW", False);
+    XSelectInput(display, DefaultRootWindow(display), PropertyChangeMask);
+
+    auto xinputOpcode = 0;
+    auto xinputEvent = 0;
+    auto xinputError = 0;
+    auto major = 2;
+    auto minor = 0;
+    auto const hasXInput = XQueryExtension(display, "XInputExtension", &xinputOpcode, &xinputEvent, &xinputError) && XIQueryVersion(display, &major, &minor) == Success;
+    assert((hasXInput || follow != FollowMode::POINTER) && "XINPUT 2 IS UNAVAILABLE");
+
+    if (hasXInput)
+    {
+        // property events tell when something else wrote over a switch. raw motion is the only pointer event the
+        // root window gets no matter which window the pointer is over
+        std::array<unsigned char, XIMaskLen(XI_PropertyEvent)> propertyBits {};
+        XISetMask(propertyBits.data(), XI_PropertyEvent);
+        std::array<unsigned char, XIMaskLen(XI_RawMotion)> motionBits {};
+        XISetMask(motionBits.data(), XI_RawMotion);
+
+        std::array masks {
+            XIEventMask { XIAllDevices, static_cast<int>(propertyBits.size()), propertyBits.data() },
+            XIEventMask { XIAllMasterDevices, static_cast<int>(motionBits.size()), motionBits.data() }
+        };
+        XISelectEvents(display, DefaultRootWindow(display), masks.data(), follow == FollowMode::POINTER ? 2 : 1);
+    }
+    else
+    {
+        daemon_log("XInput 2 is unavailable, every profile switch writes all of its properties");
+    }
+    XFlush(display);
+
+    reapply_profiles({ Clock::now(), "startup", true, {}, {}, {} });
+
+    auto bindings = bind_profile_library(display);
+    std::vector<PropertyWrite> applied {};
+
+    OutputFollower follower { follow, {}, std::nullopt };
+    rebuild_follower(follower);
+
+    auto control = open_control_server();
+    if (control.listener == -1) daemon_log("could not listen on {}, is another daemon running?", control.path.string());
+    else daemon_log("listening on {}", control.path.string());
+
+    daemon_log("watching for hotplug, output and focus changes, rss {} KiB", get_resident_memory_kib());
+
+    std::optional<Trigger> pending {};
+    Clock::time_point deadline {};
+
+    // the last profile asked for by hotkey or control request, a re-plug brings it back over the stored profiles.
+    // focus switches don't count, the focused application gets its profile again anyway
+    std::string chosenProfile {};
+
+    std::optional<FocusChange> focus {};
+    std::string focusedApplication {};
+    std::optional<Clock::time_point> pointerMoved {};
+
+    while (!shouldStop)
+    {
+        // without property events there's no telling what else wrote in between
+        if (!hasXInput) applied.clear();
+
+        std::vector<pollfd> fds {
+            { uevents, POLLIN, 0 },
+            { ConnectionNumber(display), POLLIN, 0 }
+        };
+        add_control_pollfds(control, fds);
+
+        auto timeout = -1;
+        if (pending)
+        {
+            auto const remaining = std::chrono::ceil<std::chrono::milliseconds>(pending->retry - Clock::now());
+            timeout = std::max(0, static_cast<int>(remaining.count()));
+        }
+
+        if (focus)
+        {
+            auto const remaining = std::chrono::ceil<std::chrono::milliseconds>(focus->time + FOCUS_DEBOUNCE - Clock::now());
+            timeout = std::max(0, timeout == -1 ? static_cast<int>(remaining.count()) : std::min(timeout, static_cast<int>(remaining.count())));
+        }
+
+        if (poll(fds.data(), fds.size(), timeout) == -1 && errno != EINTR) break;
+
+        if (fds[0].revents & POLLIN)
+        {
+            while (auto const uevent = receive_uevent(uevents))
+            {
+                if (!is_pen_uevent(*uevent) || pending) continue;
+
+                // the X server only creates its device after udev is done with it, so whatever it lists
+                // right now is what was there before the plug.
+                pending = { Clock::now(), "udev add", false, get_drawing_device_ids(), {}, {} };
+                deadline = pending->time + RETRY_TIMEOUT;
+            }
+        }
+
+        while (XPending(display))
+        {
+            XEvent event {};
+            XNextEvent(display, &event);
+            XRRUpdateConfiguration(&event);
+
+            if (event.type == KeyPress)
+            {
+                auto const pressed = Clock::now();
+                auto const binding = std::ranges::find_if(bindings, [&] (auto&& candidate) {
+                    return candidate.hotkey && is_hotkey_event(*candidate.hotkey, static_cast<int>(event.xkey.keycode), event.xkey.state);
+                });
+
+                if (binding != bindings.end())
+                {
+                    chosenProfile = binding->profile.name;
+                    switch_profile(control, *binding, applied, pressed, "hotkey");
+                }
+            }
+            else if (event.type == PropertyNotify && event.xproperty.atom == activeWindowAtom)
+            {
+                focus = { Clock::now(), get_active_window(display, activeWindowAtom) };
+            }
+            else if (event.xcookie.type == GenericEvent && event.xcookie.extension == xinputOpcode && event.xcookie.evtype == XI_RawMotion)
+            {
+                if (!pointerMoved) pointerMoved = Clock::now();
+            }
+            else if (event.xcookie.type == GenericEvent && event.xcookie.extension == xinputOpcode && event.xcookie.evtype == XI_PropertyEvent)
+            {
+                if (!XGetEventData(display, &event.xcookie)) continue;
+
+                auto const* changed = static_cast<XIPropertyEvent const*>(event.xcookie.data);
+                forget_overwritten_write(applied, changed->deviceid, changed->property);
+
+                XFreeEventData(display, &event.xcookie);
+            }
+            else if (event.type == randrEventBase + RRScreenChangeNotify || event.type == randrEventBase + RRNotify)
+            {
+                if (!pending || !pending->force) pending = { Clock::now(), "output change", true, {}, {}, {} };
+                deadline = pending->time + RETRY_TIMEOUT;
+            }
+        }
+
+        for (auto const& request : receive_control_requests(control, fds))
+        {
+            if (request.op != ControlOp::APPLY_PROFILE)
+            {
+                handle_control_request(control, request);
+
+                // the write goes around the plans, the next switch can't take anything for granted
+                if (request.op == ControlOp::SET) applied.clear();
+                continue;
+            }
+
+            auto const binding = std::ranges::find(bindings, request.payload, [] (auto&& candidate) { return candidate.profile.name; });
+            if (binding == bindings.end() || !binding->plan)
+            {
+                send_control_response(control, request.client, ControlStatus::ERROR, fmt::format("no usable profile named '{}'", request.payload));
+                continue;
+            }
+
+            chosenProfile = binding->profile.name;
+            switch_profile(control, *binding, applied, Clock::now(), "control request");
+            send_control_response(control, request.client, ControlStatus::OK);
+        }
+
+        drop_finished_control_clients(control);
+
+        if (pending && Clock::now() >= pending->retry)
+        {
+            // an add is retried until the new device shows up or the deadline passes
+            if (!reapply_profiles(*pending) && !pending->force && Clock::now() <= deadline)
+            {
+                pending->interval = std::clamp(pending->interval * 2, RETRY_INTERVAL, MAX_RETRY_INTERVAL);
+                pending->retry = Clock::now() + pending->interval;
+            }
+            else
+            {
+                auto const trigger = *std::exchange(pending, std::nullopt);
+                compile_bindings(bindings);
+                applied.clear();
+                rebuild_follower(follower);
+
+                auto const chosen = std::ranges::find(bindings, chosenProfile, [] (auto&& candidate) { return candidate.profile.name; });
+                if (!chosenProfile.empty() && chosen != bindings.end()) switch_profile(control, *chosen, applied, trigger.time, trigger.reason);
+
+                broadcast_control_event(control, fmt::format("devices {}", fmt::join(get_drawing_device_ids(), " ")));
+            }
+        }
+
+        // a burst of motion only needs the position it ended at
+        if (pointerMoved)
+        {
+            auto const [x, y] = get_pointer_position(display);
+            follow_point(control, follower, x, y, *pointerMoved, "pointer motion");
+            pointerMoved.reset();
+        }
+
+        if (focus && Clock::now() >= focus->time + FOCUS_DEBOUNCE)
+        {
+            auto const application = get_window_class(display, focus->window);
+            if (application != focusedApplication)
+            {
+                focusedApplication = application;
+
+                auto const* binding = find_application_binding(bindings, focusedApplication);
+                if (binding != nullptr) switch_profile(control, *binding, applied, focus->time, fmt::format("focusing '{}'", focusedApplication));
+            }
+
+            if (follow == FollowMode::FOCUS)
+            {
+                if (auto const center = get_window_center(display, focus->window))
+                {
+                    follow_point(control, follower, center->first, center->second, focus->time, "focus change");
+                }
+            }
+
+            focus.reset();
+        }
+    }
+
+    daemon_log("stopping");
+
+    for (auto const& binding : bindings)
+    {
+        if (binding.hotkey) ungrab_hotkey(display, *binding.hotkey);
+    }
+
+    close_control_server(control);
+    XCloseDisplay(display);
+    close(uevents);
+
+    return 0;
+}
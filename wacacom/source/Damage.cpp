@@ -0,0 +1,307 @@
+#include "Damage.hpp"
+
+#include "Texture.hpp"
+
+#include "imgui/imgui.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+
+#include "X11.hpp"
+
+// glx.h names the connection type the way Xlib does, see X11.hpp
+#define Display XDisplay
+#include <GL/glx.h>
+#undef Display
+
+// past this many the scissor passes cost more than the pixels they save, the rects collapse into one
+static auto constexpr MAX_DAMAGE_RECTS = 8zu;
+// and past this much of the window it's simpler to redraw all of it
+static auto constexpr FULL_DAMAGE_FRACTION = 0.6;
+
+static auto constexpr EMPTY_BOUNDS = ImVec4 {
+    std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()
+};
+
+// one draw list as it was last put on screen
+struct RetainedDrawList
+{
+    std::string owner;
+    std::vector<ImDrawVert> vertices;
+    std::vector<ImDrawIdx> indices;
+    std::vector<ImDrawCmd> commands;
+};
+
+struct RetainedFrame
+{
+    std::vector<RetainedDrawList> lists;
+    std::vector<RetainedDrawList> spare; // the frame before, its buffers get reused for the next one
+    std::uint64_t textureGeneration;
+    int width, height;
+};
+
+// rects are ImVec4s the way imgui's clip rects are, min x, min y, max x, max y
+
+static bool is_empty(ImVec4 const& rect)
+{
+    return rect.z <= rect.x || rect.w <= rect.y;
+}
+
+static ImVec4 intersect(ImVec4 const& a, ImVec4 const& b)
+{
+    return { std::max(a.x, b.x), std::max(a.y, b.y), std::min(a.z, b.z), std::min(a.w, b.w) };
+}
+
+static ImVec4 unite(ImVec4 const& a, ImVec4 const& b)
+{
+    return { std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.z, b.z), std::max(a.w, b.w) };
+}
+
+// touching counts, two rects a pixel apart cost more as two scissor passes than as one
+static bool overlaps(ImVec4 const& a, ImVec4 const& b)
+{
+    return a.x <= b.z + 1.f && b.x <= a.z + 1.f && a.y <= b.w + 1.f && b.y <= a.w + 1.f;
+}
+
+static void add_damage(std::vector<ImVec4>& damage, ImVec4 const& rect)
+{
+    if (is_empty(rect)) return;
+
+    auto const existing = std::ranges::find_if(damage, [&] (auto const& other) { return overlaps(other, rect); });
+    if (existing != damage.end()) *existing = unite(*existing, rect);
+    else damage.push_back(rect);
+}
+
+// the clip rects bound everything a list draws, for when there's no telling what changed inside them
+static void add_clip_damage(std::vector<ImVec4>& damage, std::span<ImDrawCmd const> commands)
+{
+    for (auto const& command : commands) add_damage(damage, command.ClipRect);
+}
+
+// every triangle that uses a vertex in [first, last), or samples a texture that changed, clipped the way it's drawn
+static void add_triangle_damage(std::vector<ImVec4>& damage, RetainedDrawList const& list, std::size_t first, std::size_t last, bool texturesChanged)
+{
+    auto const fontTexture = ImGui::GetIO().Fonts->TexID;
+
+    for (auto const& command : list.commands)
+    {
+        auto const sampled = texturesChanged && command.TextureId != fontTexture;
+
+        for (auto i = 0zu; i + 2 < command.ElemCount; i += 3)
+        {
+            std::array<std::size_t, 3> corners {};
+            for (auto corner = 0zu; corner < corners.size(); corner += 1)
+            {
+                corners[corner] = list.indices[command.IdxOffset + i + corner] + command.VtxOffset;
+            }
+
+            auto const touched = sampled || std::ranges::any_of(corners, [&] (auto index) { return index >= first && index < last; });
+            if (!touched) continue;
+
+            auto bounds = EMPTY_BOUNDS;
+            for (auto const index : corners)
+            {
+                auto const& position = list.vertices[index].pos;
+                bounds = unite(bounds, { position.x, position.y, position.x, position.y });
+            }
+
+            add_damage(damage, intersect(bounds, command.ClipRect));
+        }
+    }
+}
+
+static bool same_command_state(ImDrawCmd const& a, ImDrawCmd const& b)
+{
+    return std::memcmp(&a.ClipRect, &b.ClipRect, sizeof(a.ClipRect)) == 0 && a.TextureId == b.TextureId && a.VtxOffset == b.VtxOffset;
+}
+
+// imgui writes a widget's vertices and indices together and in order, so whatever changed sits between the longest
+// common prefix and suffix of the two vertex buffers
+static void add_list_damage(std::vector<ImVec4>& damage, RetainedDrawList const& before, RetainedDrawList const& after, bool texturesChanged)
+{
+    auto const callbacks = std::ranges::any_of(after.commands, [] (auto const& command) { return command.UserCallback != nullptr; });
+
+    if (callbacks || before.commands.size() != after.commands.size())
+    {
+        add_clip_damage(damage, before.commands);
+        add_clip_damage(damage, after.commands);
+        return;
+    }
+
+    for (auto i = 0zu; i < after.commands.size(); i += 1)
+    {
+        if (same_command_state(before.commands[i], after.commands[i])) continue;
+        add_damage(damage, before.commands[i].ClipRect);
+        add_damage(damage, after.commands[i].ClipRect);
+    }
+
+    auto const same = [] (ImDrawVert const& a, ImDrawVert const& b) { return std::memcmp(&a, &b, sizeof(ImDrawVert)) == 0; };
+    auto const shared = std::min(before.vertices.size(), after.vertices.size());
+
+    auto prefix = 0zu;
+    while (prefix < shared && same(before.vertices[prefix], after.vertices[prefix])) prefix += 1;
+
+    auto suffix = 0zu;
+    while (suffix < shared - prefix && same(before.vertices[before.vertices.size() - 1 - suffix], after.vertices[after.vertices.size() - 1 - suffix])) suffix += 1;
+
+    auto const verticesChanged = prefix != before.vertices.size() || prefix != after.vertices.size();
+
+    // the same vertices put together differently, rare enough to not be worth finding out where
+    if (!verticesChanged && before.indices != after.indices)
+    {
+        add_clip_damage(damage, before.commands);
+        add_clip_damage(damage, after.commands);
+        return;
+    }
+
+    if (!verticesChanged && !texturesChanged) return;
+
+    add_triangle_damage(damage, before, prefix, before.vertices.size() - suffix, texturesChanged);
+    add_triangle_damage(damage, after, prefix, after.vertices.size() - suffix, texturesChanged);
+}
+
+static void retain_draw_list(RetainedDrawList& retained, ImDrawList const& list)
+{
+    retained.owner = list._OwnerName != nullptr ? list._OwnerName : "";
+    retained.vertices.assign(list.VtxBuffer.begin(), list.VtxBuffer.end());
+    retained.indices.assign(list.IdxBuffer.begin(), list.IdxBuffer.end());
+    retained.commands.assign(list.CmdBuffer.begin(), list.CmdBuffer.end());
+}
+
+std::vector<Region> update_frame_damage(DamageTracker& tracker, ImDrawData const& data, int width, int height)
+{
+    if (!tracker.retained) tracker.retained = std::make_shared<RetainedFrame>();
+    auto& retained = *tracker.retained;
+
+    auto const generation = get_texture_generation();
+    auto const everything = !tracker.valid || retained.width != width || retained.height != height;
+    auto const texturesChanged = generation != retained.textureGeneration;
+
+    auto& lists = retained.spare;
+    lists.resize(static_cast<std::size_t>(data.CmdLists.Size));
+    for (auto i = 0zu; i < lists.size(); i += 1) retain_draw_list(lists[i], *data.CmdLists[static_cast<int>(i)]);
+
+    std::vector<ImVec4> damage {};
+
+    // lists are matched by position and owner, a window that moves in the stacking order damages every list it passed
+    for (auto i = 0zu; !everything && i < std::max(lists.size(), retained.lists.size()); i += 1)
+    {
+        auto const* before = i < retained.lists.size() ? &retained.lists[i] : nullptr;
+        auto const* after = i < lists.size() ? &lists[i] : nullptr;
+
+        if (before && after && before->owner == after->owner)
+        {
+            add_list_damage(damage, *before, *after, texturesChanged);
+            continue;
+        }
+
+        if (before) add_clip_damage(damage, before->commands);
+        if (after) add_clip_damage(damage, after->commands);
+    }
+
+    std::swap(retained.lists, retained.spare);
+    retained.textureGeneration = generation;
+    retained.width = width;
+    retained.height = height;
+    tracker.valid = true;
+
+    // merging two rects can make them reach a third one
+    for (auto merged = true; merged;)
+    {
+        merged = false;
+        for (auto i = 0zu; i < damage.size() && !merged; i += 1)
+        {
+            for (auto j = i + 1; j < damage.size() && !merged; j += 1)
+            {
+                if (!overlaps(damage[i], damage[j])) continue;
+                damage[i] = unite(damage[i], damage[j]);
+                damage.erase(damage.begin() + static_cast<std::ptrdiff_t>(j));
+                merged = true;
+            }
+        }
+    }
+
+    if (damage.size() > MAX_DAMAGE_RECTS)
+    {
+        damage = { std::accumulate(damage.begin(), damage.end(), EMPTY_BOUNDS, unite) };
+    }
+
+    auto const framebuffer = ImVec4 { 0.f, 0.f, static_cast<float>(width), static_cast<float>(height) };
+    auto const& offset = data.DisplayPos;
+    auto const& scale = data.FramebufferScale;
+
+    std::vector<Region> regions {};
+    auto area = 0.0;
+
+    for (auto const& rect : damage)
+    {
+        // out to whole pixels, a partly covered pixel is a changed pixel
+        auto const scaled = intersect(framebuffer, {
+            std::floor((rect.x - offset.x) * scale.x), std::floor((rect.y - offset.y) * scale.y),
+            std::ceil((rect.z - offset.x) * scale.x), std::ceil((rect.w - offset.y) * scale.y)
+        });
+
+        if (is_empty(scaled)) continue;
+
+        Region const region {
+            static_cast<int>(scaled.x), static_cast<int>(scaled.y), static_cast<int>(scaled.z - scaled.x), static_cast<int>(scaled.w - scaled.y)
+        };
+
+        area += static_cast<double>(region.width) * region.height;
+        regions.push_back(region);
+    }
+
+    if (everything || area > FULL_DAMAGE_FRACTION * width * height) return { Region { 0, 0, width, height } };
+
+    return regions;
+}
+
+std::optional<DamagePresenter> open_damage_presenter(GLFWwindow* window)
+{
+    if (glfwGetPlatform() != GLFW_PLATFORM_X11 || glfwGetWindowAttrib(window, GLFW_CONTEXT_CREATION_API) != GLFW_NATIVE_CONTEXT_API)
+    {
+        return std::nullopt;
+    }
+
+    auto* display = glXGetCurrentDisplay();
+    auto const drawable = glXGetCurrentDrawable();
+    if (display == nullptr || drawable == 0) return std::nullopt;
+
+    auto const* extensions = glXQueryExtensionsString(display, XDefaultScreen(display));
+    if (extensions == nullptr) return std::nullopt;
+
+    // the list is space separated and one name can be the prefix of another
+    auto const supported = (" " + std::string(extensions) + " ").contains(" GLX_MESA_copy_sub_buffer ");
+    if (!supported) return std::nullopt;
+
+    auto const copy = glXGetProcAddressARB(reinterpret_cast<GLubyte const*>("glXCopySubBufferMESA"));
+    if (copy == nullptr) return std::nullopt;
+
+    return DamagePresenter { display, drawable, reinterpret_cast<void (*)(_XDisplay*, unsigned long, int, int, int, int)>(copy) };
+}
+
+void present_damage(DamagePresenter const& presenter, std::span<Region const> damage, int height)
+{
+    // glx counts rows from the bottom
+    for (auto const& region : damage)
+    {
+        presenter.copySubBuffer(presenter.display, presenter.drawable, region.offsetX, height - region.offsetY - region.height, region.width, region.height);
+    }
+}
+
+bool is_software_renderer()
+{
+    auto const* renderer = reinterpret_cast<char const*>(glGetString(GL_RENDERER));
+    if (renderer == nullptr) return false;
+
+    std::string_view const name { renderer };
+    return name.contains("llvmpipe") || name.contains("softpipe") || name.contains("Software Rasterizer");
+}
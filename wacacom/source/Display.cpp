@@ -7,7 +7,7 @@ std::vector<Display> list_active_displays()
     auto const command = "xrandr --listactivemonitors";
     auto const fd = popen(command, "r");
     assert(fd && "FILE DESCRIPTOR WAS NULL");
-    auto const matcher = ctre::search<R"((\d+):\s*\+(\*?)([A-Za-z0-9\-]+)\s(\d+)\/\d+x(\d+))">;
+    auto const matcher = ctre::search<R"((\d+):\s*\+(\*?)([A-Za-z0-9\-]+)\s(\d+)\/\d+x(\d+)\/\d+\+(-?\d+)\+(-?\d+))">;
 
     while (true)
     {
@@ -15,10 +15,10 @@ std::vector<Display> list_active_displays()
         if (fgets(buffer.data(), buffer.size(), fd) == nullptr) break;
         std::string data(buffer.data());
         data.pop_back();
-        auto [expression, id, primary, name, width, height] = matcher(data);
+        auto [expression, id, primary, name, width, height, offsetX, offsetY] = matcher(data);
         if (expression)
         {
-            monitors.push_back({ id.to_number(), primary ? true : false, width.to_number(), height.to_number(), name.to_string() });
+            monitors.push_back({ id.to_number(), primary ? true : false, width.to_number(), height.to_number(), offsetX.to_number(), offsetY.to_number(), name.to_string() });
         }
     }
 
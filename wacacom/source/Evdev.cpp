@@ -0,0 +1,153 @@
+#include "Evdev.hpp"
+#include "TabletModels.hpp"
+#include "XInput.hpp"
+
+#include <linux/input.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <array>
+#include <climits>
+#include <filesystem>
+#include <fstream>
+
+static auto constexpr LONG_BITS = sizeof(unsigned long) * CHAR_BIT;
+
+template <size_t BITS>
+using Bitset = std::array<unsigned long, (BITS + LONG_BITS - 1) / LONG_BITS>;
+
+template <size_t BITS>
+static bool test_bit(Bitset<BITS> const& bits, int bit)
+{
+    auto const index = static_cast<size_t>(bit);
+    return (bits.at(index / LONG_BITS) >> (index % LONG_BITS)) & 1ul;
+}
+
+// sysfs prints capability bitmaps as space separated hex words, most significant one first
+template <size_t BITS>
+static Bitset<BITS> read_sysfs_capabilities(std::filesystem::path const& path)
+{
+    Bitset<BITS> bits {};
+
+    std::ifstream file(path);
+    std::vector<unsigned long> words {};
+    for (std::string word {}; file >> word;) words.push_back(std::stoul(word, nullptr, 16));
+
+    for (auto i = 0zu; i < words.size() && i < bits.size(); i += 1)
+    {
+        bits.at(i) = words.at(words.size() - 1 - i);
+    }
+
+    return bits;
+}
+
+static AxisInfo get_axis_info(int fd, unsigned axis)
+{
+    input_absinfo info {};
+    if (fd == -1 || ioctl(fd, EVIOCGABS(axis), &info) == -1) return {};
+    return { info.minimum, info.maximum, info.resolution };
+}
+
+std::vector<TabletNode> probe_tablet_node(InputNode const& node)
+{
+    std::vector<TabletNode> tablets {};
+
+    Bitset<KEY_CNT> keys {};
+    Bitset<ABS_CNT> axes {};
+
+    // reading the ranges needs access to the node itself, without it only the sysfs bitmaps are available
+    auto const fd = open(node.node.data(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd != -1)
+    {
+        ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys.data());
+        ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(axes)), axes.data());
+    }
+    else
+    {
+        auto const capabilities = std::filesystem::path("/sys") / node.syspath.substr(1) / "capabilities";
+        keys = read_sysfs_capabilities<KEY_CNT>(capabilities / "key");
+        axes = read_sysfs_capabilities<ABS_CNT>(capabilities / "abs");
+    }
+
+    auto const hasPosition = test_bit<ABS_CNT>(axes, ABS_X) && test_bit<ABS_CNT>(axes, ABS_Y);
+    auto const hasPen = test_bit<KEY_CNT>(keys, BTN_TOOL_PEN) && test_bit<ABS_CNT>(axes, ABS_PRESSURE);
+    auto const hasEraser = test_bit<KEY_CNT>(keys, BTN_TOOL_RUBBER);
+    auto const hasTouch = test_bit<KEY_CNT>(keys, BTN_TOOL_FINGER) && test_bit<ABS_CNT>(axes, ABS_MT_POSITION_X);
+    auto const hasPad = test_bit<KEY_CNT>(keys, BTN_0) && !hasPen && !hasTouch;
+
+    if (hasPosition)
+    {
+        TabletNode tablet {
+            { node.name, -1, DeviceType::STYLUS, node.identity, node.node },
+            get_axis_info(fd, ABS_X),
+            get_axis_info(fd, ABS_Y),
+            get_axis_info(fd, ABS_PRESSURE)
+        };
+
+        if (auto const model = find_tablet_model(node.identity.vendor, node.identity.product); model && fd == -1)
+        {
+            tablet.x = { 0, model->width, model->resolution };
+            tablet.y = { 0, model->height, model->resolution };
+            tablet.pressure = { 0, model->pressureLevels - 1, 0 };
+        }
+
+        if (hasPen) tablets.push_back(tablet);
+
+        if (hasEraser)
+        {
+            tablet.device.type = DeviceType::ERASER;
+            tablets.push_back(tablet);
+        }
+
+        if (hasTouch)
+        {
+            tablet.device.type = DeviceType::TOUCH;
+            tablets.push_back(tablet);
+        }
+
+        if (hasPad)
+        {
+            tablet.device.type = DeviceType::PAD;
+            tablets.push_back(tablet);
+        }
+    }
+
+    if (fd != -1) close(fd);
+
+    return tablets;
+}
+
+std::vector<TabletNode> discover_tablet_nodes(std::span<InputNode const> nodes)
+{
+    std::vector<TabletNode> tablets {};
+
+    for (auto const& node : nodes)
+    {
+        auto const probed = probe_tablet_node(node);
+        tablets.insert(tablets.end(), probed.begin(), probed.end());
+    }
+
+    if (tablets.empty()) return tablets;
+
+    // the X driver exposes one device per tool on a node, so they're told apart by their type
+    for (auto const& device : list_xinput_devices())
+    {
+        auto tablet = std::ranges::find_if(tablets, [&] (auto&& candidate) {
+            return candidate.device.node == device.node && candidate.device.type == device.type;
+        });
+
+        if (tablet == tablets.end()) continue;
+
+        tablet->device.name = device.name;
+        tablet->device.id = device.id;
+    }
+
+    return tablets;
+}
+
+float get_physical_size_mm(AxisInfo const& axis)
+{
+    if (axis.resolution <= 0) return 0.f;
+    return static_cast<float>(axis.maximum - axis.minimum) / static_cast<float>(axis.resolution);
+}
@@ -0,0 +1,44 @@
+#include "Follow.hpp"
+#include "Properties.hpp"
+#include "Transform.hpp"
+
+// how far past the edge of the current monitor the followed point has to go before the tablet moves over,
+// so the pointer sitting right on the border doesn't bounce it back and forth
+static auto constexpr FOLLOW_HYSTERESIS = 48;
+
+std::vector<MonitorTransform> build_monitor_transforms(std::span<Display const> displays, std::span<Device const> devices)
+{
+    std::vector<MonitorTransform> table {};
+
+    auto const screen = get_screen_region(displays);
+
+    for (auto const& display : displays)
+    {
+        auto const region = get_display_region(display);
+        auto const matrix = get_output_transform(region, screen);
+
+        MonitorTransform transform { display.name, region, {} };
+
+        for (auto const& device : devices)
+        {
+            transform.writes.push_back(make_float_write(device.id, TRANSFORM_PROPERTY.property, matrix));
+        }
+
+        table.push_back(std::move(transform));
+    }
+
+    return table;
+}
+
+std::optional<size_t> find_followed_monitor(OutputFollower const& follower, int x, int y)
+{
+    if (follower.current && is_inside_region(follower.table.at(*follower.current).region, x, y, FOLLOW_HYSTERESIS))
+    {
+        return follower.current;
+    }
+
+    auto const monitor = fplus::find_first_idx_by([&] (auto&& transform) { return is_inside_region(transform.region, x, y); }, follower.table);
+    if (monitor.is_nothing()) return follower.current;
+
+    return monitor.unsafe_get_just();
+}
@@ -0,0 +1,134 @@
+#include "Heatmap.hpp"
+#include "Math.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+static auto constexpr HEATMAP_COLUMNS = 160;
+// at most this often, bins keep counting in between
+static auto constexpr HEATMAP_UPLOAD_INTERVAL = std::chrono::milliseconds(250);
+
+Heatmap make_heatmap(AxisInfo const& x, AxisInfo const& y)
+{
+    // bins are square on the tablet, so the grid has the same aspect ratio as the active area
+    auto const width = std::max(1, x.maximum - x.minimum);
+    auto const height = std::max(1, y.maximum - y.minimum);
+    auto const rows = std::clamp(HEATMAP_COLUMNS * height / width, 1, HEATMAP_COLUMNS);
+
+    return { x, y, HEATMAP_COLUMNS, rows, std::vector<std::uint32_t>(static_cast<size_t>(HEATMAP_COLUMNS * rows)), 1, std::nullopt, true };
+}
+
+static void mark_dirty(std::optional<Region>& dirty, int column, int row)
+{
+    if (!dirty)
+    {
+        dirty = Region { column, row, 1, 1 };
+        return;
+    }
+
+    auto const right = std::max(dirty->offsetX + dirty->width, column + 1);
+    auto const bottom = std::max(dirty->offsetY + dirty->height, row + 1);
+    dirty->offsetX = std::min(dirty->offsetX, column);
+    dirty->offsetY = std::min(dirty->offsetY, row);
+    dirty->width = right - dirty->offsetX;
+    dirty->height = bottom - dirty->offsetY;
+}
+
+// the positions go onto the grid through the batch kernels, a bin is wherever they land rounded down
+void add_heatmap_samples(Heatmap& heatmap, std::span<StylusSample const> samples)
+{
+    auto const width = std::max(1, heatmap.x.maximum - heatmap.x.minimum);
+    auto const height = std::max(1, heatmap.y.maximum - heatmap.y.minimum);
+
+    std::vector<float> xs {};
+    std::vector<float> ys {};
+
+    for (auto const& sample : samples)
+    {
+        if (!sample.contact) continue;
+        xs.push_back(static_cast<float>(sample.x));
+        ys.push_back(static_cast<float>(sample.y));
+    }
+
+    auto const minX = static_cast<float>(heatmap.x.minimum);
+    auto const minY = static_cast<float>(heatmap.y.minimum);
+    lmap<float>(xs, xs, minX, minX + static_cast<float>(width), 0.f, static_cast<float>(heatmap.columns));
+    lmap<float>(ys, ys, minY, minY + static_cast<float>(height), 0.f, static_cast<float>(heatmap.rows));
+
+    for (auto i = 0zu; i < xs.size(); i += 1)
+    {
+        auto const column = std::clamp(static_cast<int>(std::floor(xs[i])), 0, heatmap.columns - 1);
+        auto const row = std::clamp(static_cast<int>(std::floor(ys[i])), 0, heatmap.rows - 1);
+
+        auto& bin = heatmap.bins[static_cast<size_t>(row * heatmap.columns + column)];
+        bin += 1;
+
+        // colors only shift when the scale doubles, everything else is a change to a handful of bins
+        if (bin > heatmap.scale)
+        {
+            heatmap.scale = std::bit_ceil(bin);
+            heatmap.rescaled = true;
+        }
+
+        mark_dirty(heatmap.dirty, column, row);
+    }
+}
+
+// transparent for unused bins, then from a faint blue to an opaque orange on a log scale, since a few spots
+// always get most of the contact
+static std::uint32_t get_heatmap_color(std::uint32_t count, std::uint32_t scale)
+{
+    if (count == 0) return 0;
+
+    auto const t = std::log2(static_cast<float>(count) + 1.f) / std::log2(static_cast<float>(scale) + 1.f);
+    auto const channel = [t] (float from, float to) { return static_cast<std::uint32_t>(std::lround((from + (to - from) * t) * 255.f)); };
+
+    auto const red = channel(0.15f, 1.f);
+    auto const green = channel(0.35f, 0.55f);
+    auto const blue = channel(1.f, 0.1f);
+    auto const alpha = channel(0.25f, 0.8f);
+
+    return red | (green << 8) | (blue << 16) | (alpha << 24);
+}
+
+HeatmapTexture create_heatmap_texture(Heatmap const& heatmap)
+{
+    return {
+        create_texture(heatmap.columns, heatmap.rows),
+        std::vector<std::uint32_t>(heatmap.bins.size()),
+        {}
+    };
+}
+
+void destroy_heatmap_texture(HeatmapTexture& texture)
+{
+    destroy_texture(texture.texture);
+    texture.pixels.clear();
+}
+
+void upload_heatmap(HeatmapTexture& texture, Heatmap& heatmap)
+{
+    if (!heatmap.dirty && !heatmap.rescaled) return;
+
+    auto const now = std::chrono::steady_clock::now();
+    if (now - texture.lastUpload < HEATMAP_UPLOAD_INTERVAL) return;
+    texture.lastUpload = now;
+
+    auto const region = heatmap.rescaled ? Region { 0, 0, heatmap.columns, heatmap.rows } : *heatmap.dirty;
+
+    for (auto row = region.offsetY; row < region.offsetY + region.height; row += 1)
+    {
+        for (auto column = region.offsetX; column < region.offsetX + region.width; column += 1)
+        {
+            auto const index = static_cast<size_t>(row * heatmap.columns + column);
+            texture.pixels[index] = get_heatmap_color(heatmap.bins[index], heatmap.scale);
+        }
+    }
+
+    update_texture(texture.texture, region, texture.pixels);
+
+    heatmap.dirty.reset();
+    heatmap.rescaled = false;
+}
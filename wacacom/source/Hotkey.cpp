@@ -0,0 +1,66 @@
+#include "Hotkey.hpp"
+
+#include <fplus/fplus.hpp>
+
+#include <array>
+#include <string>
+
+#include "X11.hpp"
+
+// caps lock and num lock change the modifier state of every key press, so grabs are made for each
+// combination of them and they are masked out when matching
+static auto constexpr IGNORED_MODIFIERS = std::array { 0u, static_cast<unsigned int>(LockMask), static_cast<unsigned int>(Mod2Mask), static_cast<unsigned int>(LockMask | Mod2Mask) };
+
+static std::optional<unsigned int> parse_modifier(std::string_view name)
+{
+    if (name == "ctrl" || name == "control") return ControlMask;
+    if (name == "alt") return Mod1Mask;
+    if (name == "shift") return ShiftMask;
+    if (name == "super") return Mod4Mask;
+    return std::nullopt;
+}
+
+// hotkeys are written as modifiers and a key joined by '+', e.g. "ctrl+alt+1"
+std::optional<Hotkey> parse_hotkey(XDisplay* display, std::string_view text)
+{
+    auto const parts = fplus::split('+', false, std::string(text));
+    if (parts.empty()) return std::nullopt;
+
+    Hotkey hotkey {};
+
+    for (auto i = 0zu; i + 1 < parts.size(); i += 1)
+    {
+        auto const modifier = parse_modifier(parts[i]);
+        if (!modifier) return std::nullopt;
+        hotkey.modifiers |= *modifier;
+    }
+
+    auto const keysym = XStringToKeysym(parts.back().data());
+    if (keysym == NoSymbol) return std::nullopt;
+
+    hotkey.keycode = XKeysymToKeycode(display, keysym);
+    if (hotkey.keycode == 0) return std::nullopt;
+
+    return hotkey;
+}
+
+void grab_hotkey(XDisplay* display, Hotkey const& hotkey)
+{
+    for (auto const ignored : IGNORED_MODIFIERS)
+    {
+        XGrabKey(display, hotkey.keycode, hotkey.modifiers | ignored, DefaultRootWindow(display), False, GrabModeAsync, GrabModeAsync);
+    }
+}
+
+void ungrab_hotkey(XDisplay* display, Hotkey const& hotkey)
+{
+    for (auto const ignored : IGNORED_MODIFIERS)
+    {
+        XUngrabKey(display, hotkey.keycode, hotkey.modifiers | ignored, DefaultRootWindow(display));
+    }
+}
+
+bool is_hotkey_event(Hotkey const& hotkey, int keycode, unsigned int state)
+{
+    return keycode == hotkey.keycode && (state & ~static_cast<unsigned int>(LockMask | Mod2Mask)) == hotkey.modifiers;
+}
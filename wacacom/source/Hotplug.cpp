@@ -0,0 +1,221 @@
+#include "Hotplug.hpp"
+
+#include <fmt/format.h>
+
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+static std::string unquote(std::string value)
+{
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') return value.substr(1, value.size() - 2);
+    return value;
+}
+
+static std::string read_sysfs_attribute(std::filesystem::path const& path)
+{
+    std::ifstream file(path);
+    std::string value {};
+    std::getline(file, value);
+    return value;
+}
+
+static int parse_hex(std::string const& value)
+{
+    return value.empty() ? 0 : std::stoi(value, nullptr, 16);
+}
+
+std::vector<InputNode> scan_input_nodes()
+{
+    std::vector<InputNode> nodes {};
+
+    std::error_code error {};
+    for (auto const& entry : std::filesystem::directory_iterator("/sys/class/input", error))
+    {
+        auto const name = entry.path().filename().string();
+        if (!name.starts_with("event")) continue;
+
+        auto const parent = std::filesystem::canonical(entry.path() / "device", error);
+        if (error) continue;
+
+        nodes.push_back({
+            {
+                parse_hex(read_sysfs_attribute(parent / "id" / "vendor")),
+                parse_hex(read_sysfs_attribute(parent / "id" / "product")),
+                read_sysfs_attribute(parent / "uniq")
+            },
+            read_sysfs_attribute(parent / "name"),
+            parent.string().substr(std::string_view("/sys").size()),
+            "/dev/input/" + name
+        });
+    }
+
+    return nodes;
+}
+
+// an input device is announced twice, first its inputN parent with the identity and then its eventN node,
+// so parents are kept around without a node until their node shows up.
+std::optional<HotplugEvent> apply_uevent(std::vector<InputNode>& nodes, Uevent const& uevent)
+{
+    if (uevent.subsystem != "input") return std::nullopt;
+
+    auto const& properties = uevent.properties;
+    auto const isNode = properties.contains("DEVNAME") && properties.at("DEVNAME").starts_with("input/event");
+    auto const parentPath = isNode ? uevent.devpath.substr(0, uevent.devpath.rfind('/')) : uevent.devpath;
+    auto const parent = std::ranges::find(nodes, parentPath, &InputNode::syspath);
+
+    if (uevent.action == "add" && !isNode && properties.contains("PRODUCT"))
+    {
+        auto const matcher = ctre::match<R"(([0-9a-fA-F]+)/([0-9a-fA-F]+)/([0-9a-fA-F]+)/([0-9a-fA-F]+))">;
+        auto [expression, bus, vendor, product, version] = matcher(properties.at("PRODUCT"));
+        if (!expression) return std::nullopt;
+
+        InputNode node {
+            { parse_hex(vendor.to_string()), parse_hex(product.to_string()), properties.contains("UNIQ") ? unquote(properties.at("UNIQ")) : "" },
+            properties.contains("NAME") ? unquote(properties.at("NAME")) : "",
+            uevent.devpath,
+            ""
+        };
+
+        if (parent != nodes.end()) *parent = node;
+        else nodes.push_back(node);
+
+        return std::nullopt;
+    }
+
+    if (uevent.action == "add" && isNode && parent != nodes.end())
+    {
+        parent->node = "/dev/" + properties.at("DEVNAME");
+        return HotplugEvent { HotplugAction::ADDED, *parent };
+    }
+
+    if (uevent.action == "remove" && parent != nodes.end())
+    {
+        auto const removed = *parent;
+        nodes.erase(parent);
+        if (isNode && !removed.node.empty()) return HotplugEvent { HotplugAction::REMOVED, removed };
+    }
+
+    return std::nullopt;
+}
+
+void start_hotplug_monitor(HotplugMonitor& monitor)
+{
+    monitor.nodes = scan_input_nodes();
+    monitor.notify = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    assert(monitor.notify != -1 && "COULD NOT CREATE EVENTFD");
+
+    monitor.thread = std::jthread([&monitor] (std::stop_token token) {
+        auto const uevents = open_uevent_socket();
+        auto const wake = eventfd(0, EFD_CLOEXEC);
+        assert(wake != -1 && "COULD NOT CREATE EVENTFD");
+
+        std::stop_callback const stop(token, [wake] {
+            std::uint64_t const value = 1;
+            [[maybe_unused]] auto const written = write(wake, &value, sizeof(value));
+        });
+
+        while (!token.stop_requested())
+        {
+            std::array<pollfd, 2> fds {{ { uevents, POLLIN, 0 }, { wake, POLLIN, 0 } }};
+            if (poll(fds.data(), fds.size(), -1) == -1)
+            {
+                // anything but a signal won't go away by polling again, the thread would only spin on it
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            if (!(fds[0].revents & POLLIN)) continue;
+
+            while (auto const uevent = receive_uevent(uevents))
+            {
+                std::scoped_lock const lock(monitor.mutex);
+                auto event = apply_uevent(monitor.nodes, *uevent);
+                if (!event) continue;
+
+                monitor.events.push_back(std::move(*event));
+                std::uint64_t const value = 1;
+                [[maybe_unused]] auto const written = write(monitor.notify, &value, sizeof(value));
+            }
+        }
+
+        close(wake);
+        close(uevents);
+    });
+}
+
+std::vector<HotplugEvent> poll_hotplug_events(HotplugMonitor& monitor)
+{
+    std::scoped_lock const lock(monitor.mutex);
+
+    std::uint64_t value {};
+    [[maybe_unused]] auto const drained = read(monitor.notify, &value, sizeof(value));
+
+    return std::exchange(monitor.events, {});
+}
+
+std::vector<InputNode> get_tracked_nodes(HotplugMonitor& monitor)
+{
+    std::scoped_lock const lock(monitor.mutex);
+    return fplus::keep_if([] (auto&& node) { return !node.node.empty(); }, monitor.nodes);
+}
+
+static Uevent make_uevent(std::string_view action, std::string_view devpath, std::vector<std::pair<std::string, std::string>> const& extra)
+{
+    std::string message = fmt::format("{}@{}", action, devpath);
+    message += '\0';
+    message += fmt::format("ACTION={}", action) + '\0' + fmt::format("DEVPATH={}", devpath) + '\0' + "SUBSYSTEM=input" + '\0';
+    for (auto const& [key, value] : extra) message += key + '=' + value + '\0';
+
+    auto const uevent = parse_uevent(message);
+    assert(uevent && "SYNTHETIC UEVENT MUST PARSE");
+    return *uevent;
+}
+
+int run_hotplug_self_test()
+{
+    auto failures = 0;
+    auto const check = [&] (bool passed, std::string_view what) {
+        if (!passed) failures += 1;
+        fmt::print("{} {}\n", passed ? "ok  " : "FAIL", what);
+    };
+
+    auto const parent = "/devices/pci0000:00/usb1/1-2/1-2:1.0/0003:056A:0357.0001/input/input21";
+    auto const child = fmt::format("{}/event7", parent);
+
+    std::vector<InputNode> nodes {};
+
+    auto const announced = apply_uevent(nodes, make_uevent("add", parent, { { "PRODUCT", "3/56a/357/110" }, { "NAME", "\"Wacom Intuos Pro M Pen\"" } }));
+    check(!announced && nodes.size() == 1 && nodes[0].node.empty(), "the inputN parent is kept without a node");
+    check(nodes.size() == 1 && nodes[0].identity == DeviceIdentity { 0x56a, 0x357, "" } && nodes[0].name == "Wacom Intuos Pro M Pen", "the parent carries the identity and the unquoted name");
+
+    auto const added = apply_uevent(nodes, make_uevent("add", child, { { "DEVNAME", "input/event7" } }));
+    check(added && added->action == HotplugAction::ADDED && added->node.node == "/dev/input/event7", "the eventN node completes the parent");
+
+    auto const orphan = apply_uevent(nodes, make_uevent("add", "/devices/virtual/input/input99/event9", { { "DEVNAME", "input/event9" } }));
+    check(!orphan && nodes.size() == 1, "a node without a known parent is ignored");
+
+    auto const malformed = apply_uevent(nodes, make_uevent("add", "/devices/virtual/input/input98", { { "PRODUCT", "not a product" } }));
+    check(!malformed && nodes.size() == 1, "a malformed PRODUCT is ignored");
+
+    auto other = make_uevent("add", "/devices/pci0000:00/usb1/1-3", {});
+    other.subsystem = "usb";
+    check(!apply_uevent(nodes, other) && nodes.size() == 1, "other subsystems are ignored");
+
+    auto const removed = apply_uevent(nodes, make_uevent("remove", child, { { "DEVNAME", "input/event7" } }));
+    check(removed && removed->action == HotplugAction::REMOVED && removed->node.node == "/dev/input/event7" && nodes.empty(), "removing the node reports it once");
+
+    auto const parentRemoved = apply_uevent(nodes, make_uevent("remove", parent, {}));
+    check(!parentRemoved && nodes.empty(), "removing the parent afterwards reports nothing");
+
+    check(!parse_uevent(std::string_view("no header")), "a message without ACTION@DEVPATH doesn't parse");
+
+    return failures;
+}
@@ -0,0 +1,279 @@
+#include "LiveState.hpp"
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <new>
+#include <thread>
+
+// a write is a few hundred bytes of copying, a reader that saw this many of them in a row isn't watching a live
+// publisher anymore
+static auto constexpr MAX_READ_RETRIES = 1u << 16;
+
+static volatile std::sig_atomic_t shouldStop = 0;
+
+std::string get_live_state_name()
+{
+    return fmt::format("/wacacom-stylus-{}", getuid());
+}
+
+static LiveSample to_live_sample(StylusSample const& sample)
+{
+    return { sample.time, sample.x, sample.y, sample.pressure, sample.tiltX, sample.tiltY, sample.contact ? 1u : 0u };
+}
+
+static StylusSample from_live_sample(LiveSample const& sample)
+{
+    return { sample.time, sample.x, sample.y, sample.pressure, sample.tiltX, sample.tiltY, sample.contact != 0 };
+}
+
+// the usual seqlock, the payload isn't atomic so the fences are what keep it inside the odd window
+template <class Function>
+static void write_live_state(LiveStateSegment& segment, Function&& write)
+{
+    auto const sequence = segment.sequence.load(std::memory_order_relaxed);
+    segment.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    write(segment);
+
+    segment.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+LiveStatePublisher open_live_state_publisher()
+{
+    LiveStatePublisher publisher { -1, nullptr, get_live_state_name() };
+
+    auto const fd = shm_open(publisher.name.data(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1) return publisher;
+
+    // a second writer would break the sequence for everyone, the lock goes away with the process that held it
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0 || ftruncate(fd, sizeof(LiveStateSegment)) != 0)
+    {
+        close(fd);
+        return publisher;
+    }
+
+    auto* mapping = mmap(nullptr, sizeof(LiveStateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(fd);
+        return publisher;
+    }
+
+    publisher.fd = fd;
+    publisher.segment = new (mapping) LiveStateSegment {};
+    publisher.segment->magic = LIVE_STATE_MAGIC;
+    publisher.segment->version = LIVE_STATE_VERSION;
+
+    return publisher;
+}
+
+void close_live_state_publisher(LiveStatePublisher& publisher)
+{
+    if (publisher.fd == -1) return;
+
+    // readers that still have it mapped keep their copy, new ones find nothing
+    shm_unlink(publisher.name.data());
+    munmap(publisher.segment, sizeof(LiveStateSegment));
+    close(publisher.fd);
+
+    publisher.fd = -1;
+    publisher.segment = nullptr;
+}
+
+void set_live_state_device(LiveStatePublisher& publisher, TabletNode const* tablet)
+{
+    if (publisher.segment == nullptr) return;
+
+    write_live_state(*publisher.segment, [&] (LiveStateSegment& segment) {
+        segment.published = 0;
+        segment.device = {};
+        segment.x = segment.y = segment.pressure = {};
+        if (tablet == nullptr) return;
+
+        std::ranges::copy_n(tablet->device.name.begin(), static_cast<std::ptrdiff_t>(std::min(tablet->device.name.size(), segment.device.size() - 1)), segment.device.begin());
+        segment.x = tablet->x;
+        segment.y = tablet->y;
+        segment.pressure = tablet->pressure;
+    });
+}
+
+// a whole batch goes in under one write, so a reader never sees half of a burst
+void publish_live_samples(LiveStatePublisher& publisher, std::span<StylusSample const> samples)
+{
+    if (publisher.segment == nullptr || samples.empty()) return;
+
+    if (samples.size() > LIVE_STATE_HISTORY) samples = samples.last(LIVE_STATE_HISTORY);
+
+    write_live_state(*publisher.segment, [&] (LiveStateSegment& segment) {
+        for (auto const& sample : samples)
+        {
+            segment.history[segment.published % LIVE_STATE_HISTORY] = to_live_sample(sample);
+            segment.published += 1;
+        }
+    });
+}
+
+std::optional<LiveStateReader> open_live_state_reader()
+{
+    auto const fd = shm_open(get_live_state_name().data(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1) return std::nullopt;
+
+    // the publisher creates the segment empty and only then sizes it, touching a mapping past the end of what's
+    // there is a SIGBUS
+    struct stat status {};
+    if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(LiveStateSegment)))
+    {
+        close(fd);
+        return std::nullopt;
+    }
+
+    auto* mapping = mmap(nullptr, sizeof(LiveStateSegment), PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(fd);
+        return std::nullopt;
+    }
+
+    LiveStateReader reader { fd, static_cast<LiveStateSegment const*>(mapping) };
+
+    if (is_live_state_abandoned(reader) || reader.segment->magic != LIVE_STATE_MAGIC || reader.segment->version != LIVE_STATE_VERSION)
+    {
+        close_live_state_reader(reader);
+        return std::nullopt;
+    }
+
+    return reader;
+}
+
+// the publisher holds the lock for as long as it lives, getting it means the segment was left behind
+bool is_live_state_abandoned(LiveStateReader const& reader)
+{
+    auto const abandoned = flock(reader.fd, LOCK_SH | LOCK_NB) == 0;
+    if (abandoned) flock(reader.fd, LOCK_UN);
+
+    return abandoned;
+}
+
+void close_live_state_reader(LiveStateReader& reader)
+{
+    if (reader.fd == -1) return;
+
+    munmap(const_cast<LiveStateSegment*>(reader.segment), sizeof(LiveStateSegment));
+    close(reader.fd);
+
+    reader.fd = -1;
+    reader.segment = nullptr;
+}
+
+// copies only the `history` newest samples, so a reader that wants the latest one pays for one
+LiveSnapshot read_live_state(LiveStateReader const& reader, std::size_t history)
+{
+    auto const& segment = *reader.segment;
+    history = std::min(history, LIVE_STATE_HISTORY);
+
+    LiveSnapshot snapshot {};
+    std::array<LiveSample, LIVE_STATE_HISTORY> samples {};
+
+    while (snapshot.retries < MAX_READ_RETRIES)
+    {
+        auto const sequence = segment.sequence.load(std::memory_order_acquire);
+
+        if (sequence % 2 == 0)
+        {
+            snapshot.published = segment.published;
+            snapshot.x = segment.x;
+            snapshot.y = segment.y;
+            snapshot.pressure = segment.pressure;
+            auto const device = segment.device;
+
+            auto const count = static_cast<std::size_t>(std::min<std::uint64_t>(snapshot.published, history));
+            for (auto i = 0zu; i < count; i += 1)
+            {
+                samples[i] = segment.history[(snapshot.published - count + i) % LIVE_STATE_HISTORY];
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (segment.sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                snapshot.device = std::string(device.data(), std::ranges::find(device, '\0'));
+                snapshot.history.resize(count);
+                std::ranges::transform(std::span(samples).first(count), snapshot.history.begin(), from_live_sample);
+                return snapshot;
+            }
+        }
+
+        snapshot.retries += 1;
+    }
+
+    snapshot.stale = true;
+    return snapshot;
+}
+
+// the reference consumer, it never makes a syscall between frames beyond its own sleep
+int run_live_state_viewer()
+{
+    auto reader = open_live_state_reader();
+    if (!reader)
+    {
+        fmt::print(stderr, "nothing is published at {}, is wacacom open with a stylus selected?\n", get_live_state_name());
+        return 1;
+    }
+
+    std::signal(SIGINT, [] (int) { shouldStop = 1; });
+    std::signal(SIGTERM, [] (int) { shouldStop = 1; });
+
+    auto retries = 0ull;
+
+    while (!shouldStop)
+    {
+        auto const snapshot = read_live_state(*reader, 1);
+        retries += snapshot.retries;
+
+        if (snapshot.stale && is_live_state_abandoned(*reader))
+        {
+            fmt::print("\n");
+            fmt::print(stderr, "the publisher went away in the middle of a write\n");
+            close_live_state_reader(*reader);
+            return 1;
+        }
+
+        if (snapshot.stale)
+        {
+            fmt::print("\r{:<32} the publisher is stuck in a write{:30}", "", "");
+        }
+        else if (snapshot.history.empty())
+        {
+            fmt::print("\r{:<32} waiting for the pen{:40}", snapshot.device.empty() ? "no device" : snapshot.device, "");
+        }
+        else
+        {
+            auto const& sample = snapshot.history.back();
+            auto const pressure = snapshot.pressure.maximum > snapshot.pressure.minimum
+                ? 100.f * static_cast<float>(sample.pressure - snapshot.pressure.minimum) / static_cast<float>(snapshot.pressure.maximum - snapshot.pressure.minimum)
+                : 0.f;
+
+            fmt::print("\r{:<32} x {:>6} y {:>6} pressure {:>5.1f}% {} {:>10} samples {:>6} retries",
+                snapshot.device, sample.x, sample.y, pressure, sample.contact ? "down" : "up  ", snapshot.published, retries);
+        }
+
+        std::fflush(stdout);
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+
+    fmt::print("\n");
+    close_live_state_reader(*reader);
+
+    return 0;
+}
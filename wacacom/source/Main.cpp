@@ -1,6 +1,28 @@
 #include "Tablet.hpp"
+#include "Canvas.hpp"
+#include "Control.hpp"
 #include "Display.hpp"
+#include "Daemon.hpp"
+#include "Damage.hpp"
+#include "Evdev.hpp"
+#include "Heatmap.hpp"
+#include "Hotplug.hpp"
+#include "LiveState.hpp"
 #include "Math.hpp"
+#include "Memory.hpp"
+#include "Predict.hpp"
+#include "Profile.hpp"
+#include "Properties.hpp"
+#include "Replay.hpp"
+#include "StateCache.hpp"
+#include "Stylus.hpp"
+#include "Texture.hpp"
+#include "Trail.hpp"
+#include "Transform.hpp"
+#include "Tray.hpp"
+#include "Tuner.hpp"
+#include "Usage.hpp"
+#include "XInput.hpp"
 
 #include <fmt/format.h>
 #include <GLFW/glfw3.h>
@@ -15,7 +37,16 @@
 
 #include "imgui/extensions/imgui_bezier_editor.hpp"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <numeric>
+#include <optional>
 #include <span>
+#include <string_view>
 
 #define H_SPACING(COUNT) ImGui::SetCursorPosY(ImGui::GetCursorPosY() + COUNT);
 
@@ -29,6 +60,18 @@
 static auto constexpr INPUT_WIDGET_WIDTH = 150;
 static auto constexpr GRAB_RADIUS = 6;
 static auto constexpr GRAB_BORDER = 2;
+static auto constexpr HOTPLUG_REFRESH_TIMEOUT = std::chrono::seconds(3);
+static auto constexpr HOTPLUG_REFRESH_INTERVAL = std::chrono::milliseconds(200);
+static auto constexpr TRAIL_DURATION = std::chrono::seconds(3);
+static auto constexpr CANVAS_WIDTH = 480;
+static auto constexpr CANVAS_HEIGHT = 270;
+
+static auto constexpr ROTATION_NAMES = std::array<std::pair<Rotation, char const*>, 4> {{
+    { Rotation::NONE, "Upright" },
+    { Rotation::CW, "Clockwise" },
+    { Rotation::HALF, "Upside Down" },
+    { Rotation::CCW, "Counterclockwise" }
+}};
 
 static void draw_background_grid(ImDrawList* const drawList, ImVec2 const& dimensions, ImRect const& mappableRegion)
 {
@@ -108,6 +151,21 @@ static bool draw_anchor_grabbers(std::string_view label, ImDrawList* const drawL
     return changed;
 }
 
+// trail points are normalized to `region`
+static void draw_pen_trail(ImDrawList* const drawList, std::span<TrailStroke const> trail, ImRect const& region)
+{
+    std::vector<ImVec2> vertices {};
+
+    for (auto const& stroke : trail)
+    {
+        vertices.clear();
+        for (auto const& point : stroke.points) vertices.push_back(ImLerp(region.Min, region.Max, ImVec2(point.x, point.y)));
+
+        auto const color = stroke.contact ? ImColor(1.f, 0.8f, 0.2f, 0.9f) : ImColor(1.f, 1.f, 1.f, 0.35f);
+        drawList->AddPolyline(vertices.data(), static_cast<int>(vertices.size()), color, ImDrawFlags_None, stroke.contact ? 2.f : 1.f);
+    }
+}
+
 static ImRect mapped_points_to_rect(ImVec2 points[4], ImVec2 const& mapperSize, ImVec2 const& cursorPosition)
 {
     ImVec2 const minArea (
@@ -123,7 +181,26 @@ static ImRect mapped_points_to_rect(ImVec2 points[4], ImVec2 const& mapperSize,
     return { minArea, maxArea };
 }
 
-bool MonitorRegionMapper(std::string_view label, ImVec2 const& dimensions, Display const& display, Region& mappedAreaOut, ImVec2 positionOut[4])
+// the area is the driver's, so its width and height are really the far corner
+static void region_to_mapped_points(Region const& area, Region const& availableArea, ImVec2 const& dimensions, ImVec2 pointsOut[4])
+{
+    ImVec2 const mappedArea (
+        lmap(static_cast<float>(area.width - area.offsetX), 0.f, static_cast<float>(availableArea.width), 0.f, dimensions.x),
+        lmap(static_cast<float>(area.height - area.offsetY), 0.f, static_cast<float>(availableArea.height), 0.f, dimensions.y)
+    );
+
+    ImVec2 const mappedAreaOffset (
+        lmap(static_cast<float>(area.offsetX), 0.f, static_cast<float>(availableArea.width), 0.f, dimensions.x),
+        lmap(static_cast<float>(area.offsetY), 0.f, static_cast<float>(availableArea.height), 0.f, dimensions.y)
+    );
+
+    pointsOut[0] = { normalize(0.f + mappedAreaOffset.x, 0.f, dimensions.x), normalize(dimensions.y - mappedAreaOffset.y, 0.f, dimensions.y) };
+    pointsOut[1] = { normalize(0.f + mappedAreaOffset.x, 0.f, dimensions.x), normalize(mappedArea.y + mappedAreaOffset.y, 0.f, dimensions.y) };
+    pointsOut[2] = { normalize(mappedArea.x + mappedAreaOffset.x, 0.f, dimensions.x), normalize(dimensions.y - mappedAreaOffset.y, 0.f, dimensions.y) };
+    pointsOut[3] = { normalize(mappedArea.x + mappedAreaOffset.x, 0.f, dimensions.x), normalize(mappedArea.y + mappedAreaOffset.y, 0.f, dimensions.y) };
+}
+
+bool MonitorRegionMapper(std::string_view label, ImVec2 const& dimensions, Display const& display, Region& mappedAreaOut, ImVec2 positionOut[4], std::span<TrailStroke const> trail = {})
 {
     auto changed = false;
 
@@ -182,15 +259,21 @@ bool MonitorRegionMapper(std::string_view label, ImVec2 const& dimensions, Displ
         ImGui::PopStyleColor();
     ImGui::PopStyleVar();
 
+    draw_pen_trail(drawList, trail, mappableRegion);
+
+    // relative to the display, and unlike the tablet's a plain size
     auto const size = mappedRegion.Max - mappedRegion.Min;
-    mappedAreaOut.width = lmap<int>(static_cast<int>(size.x), 0, static_cast<int>(dimensions.x), 0, static_cast<int>(display.width));
-    mappedAreaOut.height = lmap<int>(static_cast<int>(size.y), 0, static_cast<int>(dimensions.y), 0, static_cast<int>(display.height));
+    auto const offset = mappedRegion.Min - rootCursorPosition;
+    mappedAreaOut.offsetX = lmap<int>(static_cast<int>(std::lround(offset.x)), 0, static_cast<int>(dimensions.x), 0, static_cast<int>(display.width));
+    mappedAreaOut.offsetY = lmap<int>(static_cast<int>(std::lround(offset.y)), 0, static_cast<int>(dimensions.y), 0, static_cast<int>(display.height));
+    mappedAreaOut.width = lmap<int>(static_cast<int>(std::lround(size.x)), 0, static_cast<int>(dimensions.x), 0, static_cast<int>(display.width));
+    mappedAreaOut.height = lmap<int>(static_cast<int>(std::lround(size.y)), 0, static_cast<int>(dimensions.y), 0, static_cast<int>(display.height));
     ImGui::EndGroup();
 
     return changed;
 }
 
-bool TabletRegionMapper(std::string_view label, ImVec2 const& dimensions, Device const& device, Region& mappedAreaOut, ImVec2 positionOut[4], bool& forceProportions, bool& fullArea)
+bool TabletRegionMapper(std::string_view label, ImVec2 const& dimensions, Region const& availableArea, Region& mappedAreaOut, ImVec2 positionOut[4], bool& forceProportions, bool& fullArea, ImTextureID overlay = 0, std::span<TrailStroke const> trail = {})
 {
     auto changed = false;
 
@@ -211,6 +294,7 @@ bool TabletRegionMapper(std::string_view label, ImVec2 const& dimensions, Device
             ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyle().Colors[ImGuiCol_HeaderActive]);
                 ImGui::RenderFrame(mappableRegion.Min, mappableRegion.Max, ImGui::GetColorU32(ImGuiCol_FrameBg));
                 {
+                    if (overlay != 0) drawList->AddImage(overlay, mappableRegion.Min, mappableRegion.Max);
                     draw_background_grid(drawList, dimensions, mappableRegion);
                 }
             ImGui::PopStyleColor();
@@ -219,35 +303,15 @@ bool TabletRegionMapper(std::string_view label, ImVec2 const& dimensions, Device
 
     auto currentCursorPosition = ImGui::GetCursorPos();
 
-    static auto const availableArea = get_device_entire_area(device);
-    static auto currentArea = get_device_area(device);
-
-    ImVec2 const mappedArea (
-        lmap(static_cast<float>(currentArea.width), 0.f, static_cast<float>(availableArea.width), 0.f, dimensions.x),
-        lmap(static_cast<float>(currentArea.height), 0.f, static_cast<float>(availableArea.height), 0.f, dimensions.y)
-    );
-
-    ImVec2 const mappedAreaOffset (
-        lmap(static_cast<float>(currentArea.offsetX), 0.f, static_cast<float>(availableArea.width), 0.f, dimensions.x),
-        lmap(static_cast<float>(currentArea.offsetY), 0.f, static_cast<float>(availableArea.height), 0.f, dimensions.y)
-    );
-
     // normalized
-    static ImVec2 mappedAreaPoints[4] {
-        { normalize(0.f + mappedAreaOffset.x, 0.f, dimensions.x), normalize(dimensions.y - mappedAreaOffset.y, 0.f, dimensions.y) },
-        { normalize(0.f + mappedAreaOffset.x, 0.f, dimensions.x), normalize(mappedArea.y + mappedAreaOffset.y, 0.f, dimensions.y) },
-        { normalize(mappedArea.x + mappedAreaOffset.x, 0.f, dimensions.x), normalize(dimensions.y - mappedAreaOffset.y, 0.f, dimensions.y) },
-        { normalize(mappedArea.x + mappedAreaOffset.x, 0.f, dimensions.x), normalize(mappedArea.y + mappedAreaOffset.y, 0.f, dimensions.y) },
-    };
+    static ImVec2 mappedAreaPoints[4] {};
+    static std::optional<Region> lastMappedArea {};
+    static std::optional<Region> lastAvailableArea {};
 
-    if (fullArea)
-    {
-        currentArea = availableArea;
-        mappedAreaPoints[0] = { normalize(0.f, 0.f, dimensions.x), normalize(dimensions.y, 0.f, dimensions.y) };
-        mappedAreaPoints[1] = { normalize(0.f, 0.f, dimensions.x), normalize(mappedArea.y, 0.f, dimensions.y) };
-        mappedAreaPoints[2] = { normalize(mappedArea.x, 0.f, dimensions.x), normalize(dimensions.y, 0.f, dimensions.y) };
-        mappedAreaPoints[3] = { normalize(mappedArea.x, 0.f, dimensions.x), normalize(mappedArea.y, 0.f, dimensions.y) };
-    }
+    if (fullArea) mappedAreaOut = availableArea;
+
+    // the area was changed from outside of the mapper (typed in, by another tool, or another device was picked), so the handles follow it
+    if (mappedAreaOut != lastMappedArea || availableArea != lastAvailableArea) region_to_mapped_points(mappedAreaOut, availableArea, dimensions, mappedAreaPoints);
 
     changed = draw_anchor_grabbers(label, drawList, mappedAreaPoints, dimensions, rootCursorPosition, positionOut, forceProportions);
     if (changed) fullArea = false;
@@ -268,70 +332,769 @@ bool TabletRegionMapper(std::string_view label, ImVec2 const& dimensions, Device
         ImGui::PopStyleColor();
     ImGui::PopStyleVar();
 
-    auto const size = mappedRegion.Max - mappedRegion.Min;
+    draw_pen_trail(drawList, trail, mappableRegion);
 
-    mappedAreaOut.width = lmap(static_cast<int>(size.x), 0, static_cast<int>(dimensions.x), 0, static_cast<int>(availableArea.width));
-    mappedAreaOut.height = lmap(static_cast<int>(size.y), 0, static_cast<int>(dimensions.y), 0, static_cast<int>(availableArea.height));
-    auto const offsetX = (mappedAreaPoints[0].x > 0.f ? 1 : 0) * static_cast<int>(dimensions.x - size.x);
-    mappedAreaOut.offsetX = lmap(static_cast<int>(offsetX), 0, static_cast<int>(dimensions.x), 0, static_cast<int>(availableArea.width));
-    auto const offsetY = (mappedAreaPoints[2].y < 1.f ? 1 : 0) * static_cast<int>(dimensions.y - size.y);
-    mappedAreaOut.offsetY = lmap(static_cast<int>(offsetY), 0, static_cast<int>(dimensions.y), 0, static_cast<int>(availableArea.height));
+    if (changed)
+    {
+        auto const size = mappedRegion.Max - mappedRegion.Min;
+        auto const offset = mappedRegion.Min - rootCursorPosition;
+
+        mappedAreaOut.offsetX = lmap(static_cast<int>(offset.x), 0, static_cast<int>(dimensions.x), 0, static_cast<int>(availableArea.width));
+        mappedAreaOut.offsetY = lmap(static_cast<int>(offset.y), 0, static_cast<int>(dimensions.y), 0, static_cast<int>(availableArea.height));
+        mappedAreaOut.width = mappedAreaOut.offsetX + lmap(static_cast<int>(size.x), 0, static_cast<int>(dimensions.x), 0, static_cast<int>(availableArea.width));
+        mappedAreaOut.height = mappedAreaOut.offsetY + lmap(static_cast<int>(size.y), 0, static_cast<int>(dimensions.y), 0, static_cast<int>(availableArea.height));
+    }
+
+    lastMappedArea = mappedAreaOut;
+    lastAvailableArea = availableArea;
     ImGui::EndGroup();
 
     return changed;
 }
 
+// filled in by the frame loop in main, for the diagnostics window
+struct FrameDiagnostics
+{
+    long shownResidentKib;
+    long hiddenResidentKib; // the last time the window was hidden, 0 before that
+    float reopenTime; // milliseconds from the request to a window ready to draw
+    std::chrono::steady_clock::time_point lastSample;
+    unsigned long skippedFrames; // built but never drawn, they looked like the frame already on screen
+    unsigned long presentedFrames;
+    // what the window shows is sampled with the rest, numbers that change every frame would redraw every frame
+    float frameTime;
+    unsigned long sampledSkippedFrames;
+    unsigned long sampledPresentedFrames;
+    // pixels put on screen, 4 bytes each, about what a VNC server has to send before it compresses anything
+    double presentedBytes;
+    double presentedRate; // bytes per second over the last sample
+};
+
+// what was last put on screen, a frame that would look the same never reaches the GPU
+struct PresentedFrame
+{
+    std::uint64_t digest;
+    bool valid; // the window contents can't be trusted before the first frame or after an expose
+    bool unsynced; // the last frame was dropped or copied instead of swapped, so nothing blocked on vsync
+};
+
 struct ApplicationContext
 {
     Display display;
-    Region mappedMonitorArea;
+    Region mappedMonitorArea; // the part of the display the device maps to, relative to it
     ImVec2 mappedMonitorAreaPosition[4];
+    Rotation rotation = Rotation::NONE;
 
     std::vector<Device> devices;
+    std::vector<TabletNode> tabletNodes;
 
     Device device;
+    Region entireTabletArea;
     Region mappedTabletArea;
     ImVec2 mappedTabletAreaPosition[4];
     Pressure pressureCurve;
     std::array<float, 4> pressureCurvePoints;
 
+    ApplicationState state;
+    std::future<ApplicationState> liveState;
+
+    PropertyWatcher propertyWatcher;
+    HotplugMonitor hotplugMonitor;
+    int selectedDeviceIndex = 0;
+    std::optional<std::chrono::steady_clock::time_point> devicesRefreshDeadline; // while X hasn't caught up with a hotplug
+    std::chrono::steady_clock::time_point lastDevicesRefresh;
+
+    StylusMonitor stylusMonitor;
+    LiveStatePublisher livePublisher;
+    std::vector<StylusSample> stylusSamples;
+    std::optional<Heatmap> heatmap;
+    HeatmapTexture heatmapTexture;
+    std::optional<UsageSketch> usage;
+    std::optional<PenTrail> trail;
+    std::optional<PressureCanvas> canvas;
+    std::optional<Predictor> predictor;
+    Prediction prediction = Prediction::OFF;
+    float pipelineLatency = 0.f; // microseconds, from the pen to the screen
+    std::optional<PropertySet> driverProperties;
+    std::vector<PropertyDescriptor> driverDescriptors; // the table, with the ranges the device bounds itself
+    std::chrono::steady_clock::duration driverReadTime;
+    std::chrono::steady_clock::duration driverWriteTime;
+    std::optional<Tuner> tuner;
+    float areaCoverage = 95.f;
+
     bool forceProportions = true;
     bool fullArea = false;
+    bool lockSettings = false;
+    bool showHeatmap = true;
+    bool showTrail = true;
+    bool showCanvas = false;
+    bool showDriverSettings = false;
+    bool showDiagnostics = false;
+
+    FrameDiagnostics diagnostics;
+    PresentedFrame presented;
+    DamageTracker damage;
+    std::optional<DamagePresenter> damagePresenter; // only while partial redraw is on
 };
 
 void update_device_settings(ApplicationContext& ctx)
 {
-    ctx.mappedTabletArea = get_device_entire_area(ctx.device);
+    ctx.entireTabletArea = get_device_entire_area(ctx.device);
+    ctx.mappedTabletArea = get_device_area(ctx.device);
     ctx.pressureCurve = get_device_pressure_curve(ctx.device);
     ctx.pressureCurvePoints = { ctx.pressureCurve.minX, ctx.pressureCurve.minY, ctx.pressureCurve.maxX, ctx.pressureCurve.maxY };
 }
 
-void main_window()
+static std::vector<Device> get_tracked_drawing_devices(ApplicationContext& ctx)
 {
-    ImGui::Begin("Wacacom", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoResize);
+    ctx.tabletNodes = discover_tablet_nodes(get_tracked_nodes(ctx.hotplugMonitor));
+
+    return fplus::transform([] (auto&& tablet) { return tablet.device; },
+        fplus::keep_if([] (auto&& tablet) { return tablet.device.type == DeviceType::STYLUS && tablet.device.id != -1; }, ctx.tabletNodes)
+    );
+}
 
+// the selection sticks to the same physical device, even when it was replugged and got a new X id
+void update_devices(ApplicationContext& ctx, int& selectedDeviceIndex, std::vector<Device> devices)
+{
+    ctx.devices = std::move(devices);
+    watch_device_properties(ctx.propertyWatcher, ctx.devices);
+
+    auto const selected = fplus::find_first_idx_by([&] (auto&& device) { return is_same_device(device, ctx.device); }, ctx.devices);
+
+    if (selected.is_nothing())
+    {
+        selectedDeviceIndex = 0;
+        ctx.device = {};
+        return;
+    }
+
+    selectedDeviceIndex = static_cast<int>(selected.unsafe_get_just());
+
+    auto const& device = ctx.devices.at(selected.unsafe_get_just());
+    auto const reattached = device.id != ctx.device.id;
+    ctx.device = device;
+    if (reattached) update_device_settings(ctx);
+}
+
+// follows the node of the selected device, the heatmap starts over whenever that changes
+static void update_stylus_stream(ApplicationContext& ctx)
+{
+    auto const tablet = fplus::find_first_by([&] (auto&& node) {
+        return node.device.id == ctx.device.id && node.device.type == DeviceType::STYLUS;
+    }, ctx.tabletNodes);
+
+    auto const node = tablet.is_just() ? tablet.unsafe_get_just().device.node : std::string {};
+
+    if (node != ctx.stylusMonitor.node)
+    {
+        stop_stylus_monitor(ctx.stylusMonitor);
+        destroy_heatmap_texture(ctx.heatmapTexture);
+        ctx.heatmap.reset();
+        ctx.usage.reset();
+        ctx.trail.reset();
+        ctx.predictor.reset();
+
+        if (ctx.canvas)
+        {
+            destroy_pressure_canvas(*ctx.canvas);
+            ctx.canvas.reset();
+        }
+
+        if (ctx.tuner)
+        {
+            stop_tuner(*ctx.tuner);
+            ctx.tuner.reset();
+        }
+
+        // the monitor is stopped, so this thread is the only writer for now
+        set_live_state_device(ctx.livePublisher, tablet.is_just() ? &tablet.unsafe_get_just() : nullptr);
+
+        if (!node.empty())
+        {
+            start_stylus_monitor(ctx.stylusMonitor, node, &ctx.livePublisher);
+            ctx.heatmap = make_heatmap(tablet.unsafe_get_just().x, tablet.unsafe_get_just().y);
+            ctx.heatmapTexture = create_heatmap_texture(*ctx.heatmap);
+            ctx.usage = make_usage_sketch(tablet.unsafe_get_just().x, tablet.unsafe_get_just().y);
+            ctx.trail = make_pen_trail(tablet.unsafe_get_just().x, tablet.unsafe_get_just().y);
+            ctx.canvas = create_pressure_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, tablet.unsafe_get_just().pressure);
+            ctx.predictor = make_predictor(Prediction::OFF, tablet.unsafe_get_just().x);
+        }
+    }
+
+    ctx.stylusSamples = poll_stylus_samples(ctx.stylusMonitor);
+
+    if (ctx.usage) add_usage_samples(*ctx.usage, ctx.stylusSamples);
+    if (ctx.trail) add_trail_samples(*ctx.trail, ctx.stylusSamples);
+
+    // drawn with the area and curve as they are in the widgets, before they're applied
+    if (ctx.canvas && ctx.showCanvas)
+    {
+        auto const& points = ctx.pressureCurvePoints;
+        update_canvas_mapping(*ctx.canvas, ctx.mappedTabletArea, { points.at(0), points.at(1), points.at(2), points.at(3) });
+        add_canvas_samples(*ctx.canvas, ctx.stylusSamples);
+        upload_pressure_canvas(*ctx.canvas);
+    }
+
+    // closing the window is as good as cancelling
+    if (ctx.tuner && !ctx.showDriverSettings)
+    {
+        stop_tuner(*ctx.tuner);
+        ctx.tuner.reset();
+    }
+
+    if (ctx.tuner) update_tuner(*ctx.tuner, ctx.stylusSamples);
+
+    if (ctx.predictor)
+    {
+        if (ctx.predictor->mode != ctx.prediction)
+        {
+            ctx.predictor->mode = ctx.prediction;
+            reset_predictor(*ctx.predictor);
+        }
+
+        for (auto const& sample : ctx.stylusSamples) update_predictor(*ctx.predictor, sample);
+    }
+
+    // how old the newest report is by now, plus the frame it's about to be drawn in going out with the next
+    // refresh. smoothed, since when exactly a report lands within a frame is random.
+    if (!ctx.stylusSamples.empty())
+    {
+        auto const now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        auto const latency = static_cast<float>(now - ctx.stylusSamples.back().time) + ImGui::GetIO().DeltaTime * 1e6f;
+        ctx.pipelineLatency += (latency - ctx.pipelineLatency) * 0.1f;
+    }
+
+    if (ctx.heatmap)
+    {
+        add_heatmap_samples(*ctx.heatmap, ctx.stylusSamples);
+        if (ctx.showHeatmap) upload_heatmap(ctx.heatmapTexture, *ctx.heatmap);
+    }
+}
+
+// the baked strokes first, then the live ones straight from the canvas' vertices
+static void draw_pressure_canvas(ImDrawList* const drawList, PressureCanvas const& canvas, ImVec2 const& origin, std::optional<CanvasPoint> const& tip)
+{
+    drawList->AddImage(static_cast<ImTextureID>(canvas.texture.id), origin, origin + ImVec2(static_cast<float>(canvas.width), static_cast<float>(canvas.height)));
+
+    auto const uv = drawList->_Data->TexUvWhitePixel;
+
+    // the predicted bit is thrown away every frame, the next samples take its place
+    if (tip && canvas.last)
+    {
+        auto const quad = get_canvas_segment(*canvas.last, *tip);
+        drawList->PrimReserve(6, 4);
+        drawList->PrimQuadUV(
+            origin + ImVec2(quad[0].x, quad[0].y), origin + ImVec2(quad[1].x, quad[1].y),
+            origin + ImVec2(quad[2].x, quad[2].y), origin + ImVec2(quad[3].x, quad[3].y),
+            uv, uv, uv, uv, CANVAS_INK
+        );
+    }
+
+    auto const segments = static_cast<int>(canvas.vertices.size() / 4);
+    if (segments == 0) return;
+
+    drawList->PrimReserve(segments * 6, segments * 4);
+
+    for (auto i = 0zu; i < canvas.vertices.size(); i += 4)
+    {
+        auto const* quad = canvas.vertices.data() + i;
+        drawList->PrimQuadUV(
+            origin + ImVec2(quad[0].x, quad[0].y), origin + ImVec2(quad[1].x, quad[1].y),
+            origin + ImVec2(quad[2].x, quad[2].y), origin + ImVec2(quad[3].x, quad[3].y),
+            uv, uv, uv, uv, CANVAS_INK
+        );
+    }
+}
+
+static void canvas_window(ApplicationContext& ctx)
+{
+    ImGui::Begin("Pressure Canvas", &ctx.showCanvas, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse);
+
+    ImVec2 const dimensions(static_cast<float>(CANVAS_WIDTH), static_cast<float>(CANVAS_HEIGHT));
+    auto const origin = ImGui::GetCursorScreenPos();
     auto* drawList = ImGui::GetWindowDrawList();
 
-    static ApplicationContext ctx {};
+    ImGui::InvisibleButton("##Canvas", dimensions);
+    drawList->AddRectFilled(origin, origin + dimensions, ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+    if (ctx.canvas)
+    {
+        auto const position = ctx.predictor ? predict_position(*ctx.predictor, static_cast<std::int64_t>(ctx.pipelineLatency)) : std::nullopt;
+        auto const tip = position ? get_canvas_tip(*ctx.canvas, *position) : std::nullopt;
+        draw_pressure_canvas(drawList, *ctx.canvas, origin, tip);
+
+        if (ImGui::Button("Clear")) clear_pressure_canvas(*ctx.canvas);
+        ImGui::SameLine();
+        for (auto const& [mode, name] : { std::pair { Prediction::OFF, "No Prediction" }, { Prediction::LINEAR, "Linear" }, { Prediction::KALMAN, "Kalman" } })
+        {
+            if (ImGui::RadioButton(name, ctx.prediction == mode)) ctx.prediction = mode;
+            ImGui::SameLine();
+        }
+        ImGui::TextDisabled("%.1f ms behind", static_cast<double>(ctx.pipelineLatency) / 1e3);
+    }
+    else
+    {
+        ImGui::TextDisabled("No stylus");
+    }
+
+    ImGui::End();
+}
+
+static void tuner_section(ApplicationContext& ctx)
+{
+    ImGui::SeparatorText("Tuner");
+
+    auto const running = ctx.tuner && (ctx.tuner->phase == TunerPhase::HOVER || ctx.tuner->phase == TunerPhase::STROKES);
+
+    if (!running)
+    {
+        auto const tablet = fplus::find_first_by([&] (auto&& node) { return node.device.id == ctx.device.id && node.device.type == DeviceType::STYLUS; }, ctx.tabletNodes);
+
+        if (tablet.is_just() && ImGui::Button("Start Tuner"))
+        {
+            ctx.tuner = start_tuner(ctx.device, tablet.unsafe_get_just().x);
+            if (ctx.tuner->phase == TunerPhase::IDLE) ctx.tuner.reset();
+        }
+    }
+    else
+    {
+        auto const step = ctx.tuner->current + 1;
+        auto const steps = ctx.tuner->results.size();
+
+        if (ctx.tuner->phase == TunerPhase::HOVER) ImGui::Text("Hover the pen still, just above the tablet (%zu/%zu)", step, steps);
+        else ImGui::Text("Draw a few long strokes (%zu/%zu)", step, steps);
+
+        if (ImGui::Button("Cancel"))
+        {
+            stop_tuner(*ctx.tuner);
+            ctx.tuner.reset();
+        }
+    }
+
+    if (!ctx.tuner || ctx.tuner->phase != TunerPhase::DONE) return;
+
+    // the settings on the pareto front are marked, the recommended one is the best trade between the two
+    if (ImGui::BeginTable("##TunerResults", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        for (auto const* header : { "Raw Sample", "Suppress", "Jitter", "Lag" }) ImGui::TableSetupColumn(header);
+        ImGui::TableHeadersRow();
+
+        for (auto i = 0zu; i < ctx.tuner->results.size(); i += 1)
+        {
+            auto const& [candidate, jitter, lag, pareto] = ctx.tuner->results[i];
+            auto const recommended = ctx.tuner->recommended == i;
+
+            ImGui::TableNextRow();
+            if (recommended) ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg1, ImGui::GetColorU32(ImGuiCol_HeaderActive));
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%d%s", candidate.rawSample, pareto ? " *" : "");
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", candidate.suppress);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", jitter);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.0f ms", lag);
+        }
+
+        ImGui::EndTable();
+    }
+
+    if (ctx.tuner->recommended && ctx.driverProperties && ImGui::Button("Use Recommended"))
+    {
+        auto const& [rawSample, suppress] = ctx.tuner->results.at(*ctx.tuner->recommended).candidate;
+        set_property<RAW_SAMPLE_PROPERTY>(*ctx.driverProperties, { rawSample });
+        set_property<SUPPRESS_PROPERTY>(*ctx.driverProperties, { suppress });
+        ctx.tuner.reset();
+    }
+}
+
+static void diagnostics_window(ApplicationContext& ctx)
+{
+    auto& diagnostics = ctx.diagnostics;
+
+    // reading /proc every frame would show up in the numbers it's there to report
+    if (auto const now = std::chrono::steady_clock::now(); now - diagnostics.lastSample > std::chrono::seconds(1))
+    {
+        diagnostics.shownResidentKib = get_resident_memory_kib();
+        diagnostics.frameTime = 1000.f / ImGui::GetIO().Framerate;
+        diagnostics.sampledSkippedFrames = diagnostics.skippedFrames;
+        diagnostics.sampledPresentedFrames = diagnostics.presentedFrames;
+        diagnostics.presentedRate = diagnostics.presentedBytes / std::chrono::duration<double>(now - diagnostics.lastSample).count();
+        diagnostics.presentedBytes = 0.0;
+        diagnostics.lastSample = now;
+    }
+
+    ImGui::Begin("Diagnostics", &ctx.showDiagnostics, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse);
+
+    ImGui::Text("Frame: %.2f ms", static_cast<double>(diagnostics.frameTime));
+    ImGui::Text("Skipped: %lu of %lu frames", diagnostics.sampledSkippedFrames, diagnostics.sampledSkippedFrames + diagnostics.sampledPresentedFrames);
+    ImGui::Text("Redraw: %s", ctx.damagePresenter ? "partial, GLX_MESA_copy_sub_buffer" : "full");
+    ImGui::Text("Presented: %.1f KiB/s", diagnostics.presentedRate / 1024.0);
+    ImGui::Text("Resident: %ld KiB", diagnostics.shownResidentKib);
+
+    if (diagnostics.hiddenResidentKib != 0)
+    {
+        ImGui::Text("Resident while hidden: %ld KiB", diagnostics.hiddenResidentKib);
+        ImGui::Text("Reopened in: %.1f ms", static_cast<double>(diagnostics.reopenTime));
+    }
+
+    ImGui::End();
+}
+
+// every scalar setting in the table gets a slider, whatever is moved in a frame is sent in a single write
+static void driver_window(ApplicationContext& ctx)
+{
+    using Clock = std::chrono::steady_clock;
+
+    ImGui::Begin("Driver Settings", &ctx.showDriverSettings, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse);
+
+    if (!ctx.driverProperties || ctx.driverProperties->deviceId != ctx.device.id)
+    {
+        auto const start = Clock::now();
+        ctx.driverProperties = read_device_properties(ctx.device.id);
+        ctx.driverDescriptors = fplus::transform([&] (auto&& descriptor) { return get_device_property_descriptor(ctx.device.id, descriptor); }, std::vector(DRIVER_PROPERTIES.begin(), DRIVER_PROPERTIES.end()));
+        ctx.driverReadTime = Clock::now() - start;
+    }
+
+    auto& set = *ctx.driverProperties;
+
+    for (auto const& descriptor : ctx.driverDescriptors)
+    {
+        if (descriptor.arity != 1 || descriptor.type != PropertyType::INTEGER) continue;
+
+        std::string const label(descriptor.label);
+        auto const values = get_property_values(set, descriptor);
+
+        if (!values)
+        {
+            ImGui::TextDisabled("%s isn't supported by the device", label.data());
+            continue;
+        }
+
+        auto value = static_cast<int>(values->front());
+        ImGui::SetNextItemWidth(INPUT_WIDGET_WIDTH * 2);
+        if (ImGui::SliderInt(label.data(), &value, static_cast<int>(descriptor.minimum), static_cast<int>(descriptor.maximum)))
+        {
+            set_property_values(set, descriptor, std::array { static_cast<double>(value) });
+        }
+    }
+
+    if (!get_property_writes(set).empty())
+    {
+        auto const start = Clock::now();
+        auto const written = write_property_set(set);
+        ctx.driverWriteTime = Clock::now() - start;
+
+        // the device is gone, the next frame reads whatever took its place
+        if (!written) ctx.driverProperties.reset();
+    }
+
+    auto const toMilliseconds = [] (auto duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+    ImGui::TextDisabled("Raw Sample and Suppress smooth the pen out at the cost of latency");
+    ImGui::Text("read %.2f ms, last write %.2f ms", toMilliseconds(ctx.driverReadTime), toMilliseconds(ctx.driverWriteTime));
+    ImGui::Text("pen to screen %.1f ms", static_cast<double>(ctx.pipelineLatency) / 1e3);
+
+    if (ImGui::Button("Refresh")) ctx.driverProperties.reset();
+
+    tuner_section(ctx);
+
+    ImGui::End();
+}
+
+// what Apply stores and sends, and what the monitor mapper previews the trail through
+static Profile get_pending_profile(ApplicationContext const& ctx)
+{
+    return {
+        ctx.device.name,
+        ctx.display.name,
+        ctx.mappedTabletArea,
+        {
+            ctx.pressureCurvePoints.at(0),
+            ctx.pressureCurvePoints.at(1),
+            ctx.pressureCurvePoints.at(2),
+            ctx.pressureCurvePoints.at(3)
+        },
+        // so a circle drawn on the tablet stays a circle
+        ctx.forceProportions,
+        ctx.rotation,
+        ctx.mappedMonitorArea
+    };
+}
+
+// the trail as a mapper draws it: tablet units onto [0, 1] across `area` first, which is in the driver's
+// x1 y1 x2 y2 form and where the pen is pinned to the edges once it leaves it like the driver does, then onto
+// `output`. the area step goes through the batch kernels an axis at a time
+static std::vector<TrailStroke> transform_trail_strokes(std::vector<TrailStroke> strokes, Region const& area, TransformMatrix const& output)
+{
+    auto const left = static_cast<float>(area.offsetX);
+    auto const top = static_cast<float>(area.offsetY);
+    auto const right = left + static_cast<float>(std::max(area.width - area.offsetX, 1));
+    auto const bottom = top + static_cast<float>(std::max(area.height - area.offsetY, 1));
+
+    std::vector<float> xs {};
+    std::vector<float> ys {};
+
+    for (auto& stroke : strokes)
+    {
+        xs.resize(stroke.points.size());
+        ys.resize(stroke.points.size());
+        std::ranges::transform(stroke.points, xs.begin(), &Point::x);
+        std::ranges::transform(stroke.points, ys.begin(), &Point::y);
+
+        normalize<float>(xs, xs, left, right);
+        normalize<float>(ys, ys, top, bottom);
+
+        for (auto i = 0zu; i < stroke.points.size(); i += 1)
+        {
+            stroke.points[i] = transform_point(output, { std::clamp(xs[i], 0.f, 1.f), std::clamp(ys[i], 0.f, 1.f) });
+        }
+    }
+
+    return strokes;
+}
+
+static bool is_same_pressure_curve(Pressure const& lhs, Pressure const& rhs)
+{
+    auto const same = [] (float a, float b) { return std::round(a * 100.f) == std::round(b * 100.f); };
+    return same(lhs.minX, rhs.minX) && same(lhs.minY, rhs.minY) && same(lhs.maxX, rhs.maxX) && same(lhs.maxY, rhs.maxY);
+}
+
+static std::optional<Display> find_primary_display(std::vector<Display> const& displays)
+{
+    auto const primary = fplus::find_first_by([] (auto&& display) { return display.primary; }, displays);
+    if (primary.is_just()) return primary.unsafe_get_just();
+    if (!displays.empty()) return displays.front();
+    return std::nullopt;
+}
+
+// X doesn't know the serial, and devices that came from xsetwacom know neither their node nor their product
+static bool is_same_xinput_device(Device const& cached, Device const& live)
+{
+    if (cached.type != live.type || cached.name != live.name) return false;
+    if (!cached.node.empty() && cached.node != live.node) return false;
+    return cached.identity.vendor == 0 || (cached.identity.vendor == live.identity.vendor && cached.identity.product == live.identity.product);
+}
+
+// the last known state is shown right away, the live one gets patched in once it has been queried
+void restore_application_state(ApplicationContext& ctx, ApplicationState state)
+{
+    // X hands ids out again after a replug or a server restart, so a cached id is only used when the same device
+    // still holds it
+    auto const live = list_xinput_devices();
+    std::vector<DeviceState> devices {};
+
+    for (auto entry : state.devices)
+    {
+        auto const match = std::ranges::find_if(live, [&] (auto&& device) { return is_same_xinput_device(entry.device, device); });
+        if (match == live.end()) continue;
+
+        entry.device.id = match->id;
+        devices.push_back(std::move(entry));
+    }
+
+    state.devices = std::move(devices);
+
+    ctx.devices = fplus::transform([] (auto&& entry) { return entry.device; }, state.devices);
+    watch_device_properties(ctx.propertyWatcher, ctx.devices);
+
+    if (auto const display = find_primary_display(state.displays)) ctx.display = *display;
+
+    if (!state.devices.empty())
+    {
+        auto const& [device, entireArea, area, pressure] = state.devices.front();
+        ctx.device = device;
+        ctx.entireTabletArea = entireArea;
+        ctx.mappedTabletArea = area;
+        ctx.pressureCurve = pressure;
+        ctx.pressureCurvePoints = { pressure.minX, pressure.minY, pressure.maxX, pressure.maxY };
+    }
+
+    ctx.state = std::move(state);
+}
+
+// only what the driver disagrees with the cache on is touched, anything else stays as the user left it
+void patch_application_state(ApplicationContext& ctx, int& selectedDeviceIndex, ApplicationState live)
+{
+    auto const cached = std::exchange(ctx.state, std::move(live));
+
+    // the query left out sensor sizes it could only get by resetting the driver's area
+    for (auto& entry : ctx.state.devices)
+    {
+        if (entry.entireArea != Region {}) continue;
+
+        if (auto const known = find_device_state(cached, entry.device); known && known->entireArea != Region {}) entry.entireArea = known->entireArea;
+        else if (is_same_device(entry.device, ctx.device)) entry.entireArea = get_device_entire_area(entry.device);
+    }
+
+    auto const& state = ctx.state;
+
+    ctx.tabletNodes = state.tabletNodes;
+
+    auto devices = fplus::transform([] (auto&& entry) { return entry.device; }, state.devices);
+    auto const getIds = [] (auto&& list) { return fplus::transform([] (auto&& device) { return device.id; }, list); };
+    if (getIds(devices) != getIds(ctx.devices)) update_devices(ctx, selectedDeviceIndex, std::move(devices));
+
+    if (auto const display = find_primary_display(state.displays))
+    {
+        auto const changed = display->name != ctx.display.name || display->width != ctx.display.width || display->height != ctx.display.height
+            || display->offsetX != ctx.display.offsetX || display->offsetY != ctx.display.offsetY;
+        if (changed) ctx.display = *display;
+    }
+
+    if (auto const current = find_device_state(state, ctx.device))
+    {
+        auto const known = find_device_state(cached, ctx.device);
+
+        if (!known || known->entireArea != current->entireArea) ctx.entireTabletArea = current->entireArea;
+        if (!known || known->area != current->area) ctx.mappedTabletArea = current->area;
+
+        if (!known || !is_same_pressure_curve(known->pressure, current->pressure))
+        {
+            ctx.pressureCurve = current->pressure;
+            ctx.pressureCurvePoints = { ctx.pressureCurve.minX, ctx.pressureCurve.minY, ctx.pressureCurve.maxX, ctx.pressureCurve.maxY };
+        }
+    }
+
+    save_state_cache(ctx.state);
+}
+
+// something else wrote to the driver: either adopt its values, or put the stored profile back if the settings are locked
+void update_device_settings(ApplicationContext& ctx, PropertyChange const& change)
+{
+    if (ctx.lockSettings)
+    {
+        auto const profile = fplus::find_first_by([&] (auto&& stored) { return stored.device == ctx.device.name; }, load_profiles());
+        if (profile.is_nothing()) return;
+
+        auto const& desired = profile.unsafe_get_just();
+        auto const areaDiffers = change.area && *change.area != desired.area;
+        auto const pressureDiffers = change.pressure && !is_same_pressure_curve(*change.pressure, desired.pressure);
+        if (areaDiffers || pressureDiffers) apply_profile(ctx.device, desired);
+
+        return;
+    }
+
+    if (change.area)
+    {
+        ctx.mappedTabletArea = *change.area;
+    }
+
+    if (change.pressure)
+    {
+        ctx.pressureCurve = *change.pressure;
+        ctx.pressureCurvePoints = { ctx.pressureCurve.minX, ctx.pressureCurve.minY, ctx.pressureCurve.maxX, ctx.pressureCurve.maxY };
+    }
+}
+
+// everything that has to keep going whether the window is shown or not: the device list, the settings read back
+// from the driver, and lockSettings putting them back when something else changed them
+static void update_backend(ApplicationContext& ctx)
+{
+    if (ctx.propertyWatcher.display == nullptr) ctx.propertyWatcher = open_property_watcher();
+    if (ctx.livePublisher.name.empty()) ctx.livePublisher = open_live_state_publisher();
+
+    if (!ctx.hotplugMonitor.thread.joinable())
+    {
+        start_hotplug_monitor(ctx.hotplugMonitor);
+
+        if (auto cached = load_state_cache())
+        {
+            restore_application_state(ctx, std::move(*cached));
+        }
+        else
+        {
+            update_devices(ctx, ctx.selectedDeviceIndex, get_tracked_drawing_devices(ctx));
+            if (ctx.devices.empty()) update_devices(ctx, ctx.selectedDeviceIndex, get_drawing_devices());
+        }
+
+        ctx.liveState = std::async(std::launch::async, query_application_state);
+    }
+
+    if (ctx.liveState.valid() && ctx.liveState.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        patch_application_state(ctx, ctx.selectedDeviceIndex, ctx.liveState.get());
+    }
+
+    // X only picks a device up (or drops it) some time after the kernel announced it, so the list is
+    // re-resolved until it actually changes. not every frame though, each try walks sysfs and lists every X device.
+    if (!poll_hotplug_events(ctx.hotplugMonitor).empty()) ctx.devicesRefreshDeadline = std::chrono::steady_clock::now() + HOTPLUG_REFRESH_TIMEOUT;
+
+    if (ctx.devicesRefreshDeadline && std::chrono::steady_clock::now() - ctx.lastDevicesRefresh >= HOTPLUG_REFRESH_INTERVAL)
+    {
+        ctx.lastDevicesRefresh = std::chrono::steady_clock::now();
+
+        auto devices = get_tracked_drawing_devices(ctx);
+        auto const getIds = [] (auto&& list) { return fplus::transform([] (auto&& device) { return device.id; }, list); };
+
+        if (getIds(devices) != getIds(ctx.devices))
+        {
+            update_devices(ctx, ctx.selectedDeviceIndex, std::move(devices));
+            ctx.devicesRefreshDeadline.reset();
+        }
+        else if (std::chrono::steady_clock::now() > *ctx.devicesRefreshDeadline)
+        {
+            ctx.devicesRefreshDeadline.reset();
+        }
+    }
 
-    if (ctx.devices.empty()) ctx.devices = get_drawing_devices();
     if (ctx.display.name.empty()) ctx.display = get_primary_display();
     if (!ctx.devices.empty() && ctx.device.name.empty()) ctx.device = ctx.devices.front(), update_device_settings(ctx);
 
-    static auto selectedDeviceIndex = 0;
+    for (auto const& change : poll_property_changes(ctx.propertyWatcher))
+    {
+        if (change.deviceId == ctx.device.id) update_device_settings(ctx, change);
+    }
+}
+
+void main_window(ApplicationContext& ctx)
+{
+    ImGui::Begin("Wacacom", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoResize);
+
+    auto* drawList = ImGui::GetWindowDrawList();
+
     static auto hasChangedDevice = false;
 
-    if ((hasChangedDevice || ctx.device.name.empty()) && !ctx.devices.empty()) update_device_settings(ctx);
+    if (hasChangedDevice && !ctx.devices.empty())
+    {
+        ctx.device = ctx.devices.at(static_cast<size_t>(ctx.selectedDeviceIndex));
+        update_device_settings(ctx);
+    }
+
+    update_backend(ctx);
+
+    update_stylus_stream(ctx);
+
+    // the monitor side goes through the area as it is in the widgets, not as it was last applied
+    auto const trail = [&] {
+        if (!ctx.showTrail || !ctx.trail) return std::vector<TrailStroke> {};
+        auto const now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
+        return get_trail_strokes(*ctx.trail, (now - TRAIL_DURATION).count());
+    }();
+
+    auto const pending = get_pending_profile(ctx);
+    auto const displayRegion = get_display_region(ctx.display);
+    auto const tabletTrail = transform_trail_strokes(trail, ctx.entireTabletArea, IDENTITY_TRANSFORM);
+    auto const monitorTrail = transform_trail_strokes(trail, pending.area, get_output_transform(get_profile_output_region(pending, ctx.display), displayRegion, pending.rotation));
 
     ImGui::BeginGroup();
         static ImVec2 constexpr MONITOR_MAPPER_DIM(20.f * 16, 20.f * 9);
-        static auto MONITOR_MAPPER_LABEL = fmt::format("Display ({} {}x{})", ctx.display.name, ctx.display.width, ctx.display.height);
+        auto const MONITOR_MAPPER_LABEL = fmt::format("Display ({} {}x{})", ctx.display.name, ctx.display.width, ctx.display.height);
         ImGui::SetCursorPosX(ImGui::GetCursorPosX() + (ImGui::GetContentRegionAvail().x - MONITOR_MAPPER_DIM.x) / 2);
-        MonitorRegionMapper(MONITOR_MAPPER_LABEL, MONITOR_MAPPER_DIM, ctx.display, ctx.mappedMonitorArea, ctx.mappedMonitorAreaPosition);
+        MonitorRegionMapper(MONITOR_MAPPER_LABEL, MONITOR_MAPPER_DIM, ctx.display, ctx.mappedMonitorArea, ctx.mappedMonitorAreaPosition, monitorTrail);
         ImVec2 const TABLET_MAPPER_DIM(15.f * 16, 15.f * 9);
-        static auto constexpr TABLET_MAPPER_LABEL = "Tablet";
+        auto const tablet = fplus::find_first_by([&] (auto&& node) { return node.device.id == ctx.device.id && node.device.type == ctx.device.type; }, ctx.tabletNodes);
+        auto const TABLET_MAPPER_LABEL = tablet.is_just() && tablet.unsafe_get_just().x.resolution > 0
+            ? fmt::format("Tablet ({:.0f}x{:.0f} mm, {} levels)",
+                get_physical_size_mm(tablet.unsafe_get_just().x),
+                get_physical_size_mm(tablet.unsafe_get_just().y),
+                tablet.unsafe_get_just().pressure.maximum + 1)
+            : std::string("Tablet");
         ImGui::SetCursorPosX(ImGui::GetCursorPosX() + (ImGui::GetContentRegionAvail().x - TABLET_MAPPER_DIM.x) / 2);
-        TabletRegionMapper(TABLET_MAPPER_LABEL, TABLET_MAPPER_DIM, ctx.device, ctx.mappedTabletArea, ctx.mappedTabletAreaPosition, ctx.forceProportions, ctx.fullArea);
+        auto const heatmapOverlay = ctx.showHeatmap && ctx.heatmap ? static_cast<ImTextureID>(ctx.heatmapTexture.texture.id) : ImTextureID {};
+        TabletRegionMapper(TABLET_MAPPER_LABEL, TABLET_MAPPER_DIM, ctx.entireTabletArea, ctx.mappedTabletArea, ctx.mappedTabletAreaPosition, ctx.forceProportions, ctx.fullArea, heatmapOverlay, tabletTrail);
     ImGui::EndGroup();
 
     SEPARATOR(10);
@@ -343,7 +1106,7 @@ void main_window()
             ImGui::SetNextItemWidth(8 + 300);
             hasChangedDevice = ImGui::Combo(
                 "##Device",
-                &selectedDeviceIndex,
+                &ctx.selectedDeviceIndex,
                 fplus::transform([] (auto const& data) { return data.data(); },
                     fplus::transform([] (auto const& device) { return device.name; }, ctx.devices)
                 ).data(),
@@ -368,7 +1131,36 @@ void main_window()
             ImGui::EndGroup();
             ImGui::BeginGroup();
                 ImGui::Checkbox("Full Area", &ctx.fullArea);
-                ImGui::Checkbox("Force Proportions", &ctx.fullArea);
+                ImGui::Checkbox("Force Proportions", &ctx.forceProportions);
+                ImGui::Checkbox("Lock Settings", &ctx.lockSettings);
+                ImGui::Checkbox("Heatmap", &ctx.showHeatmap);
+                ImGui::Checkbox("Pen Trail", &ctx.showTrail);
+                ImGui::Checkbox("Test Canvas", &ctx.showCanvas);
+                ImGui::Checkbox("Driver Settings", &ctx.showDriverSettings);
+                ImGui::Checkbox("Diagnostics", &ctx.showDiagnostics);
+            ImGui::EndGroup();
+            ImGui::BeginGroup();
+                ImGui::SetNextItemWidth(INPUT_WIDGET_WIDTH);
+                ImGui::SliderFloat("##AreaCoverage", &ctx.areaCoverage, 50.f, 100.f, "%.0f%%+ of contact");
+                ImGui::SetNextItemWidth(INPUT_WIDGET_WIDTH);
+                auto const rotation = std::ranges::find(ROTATION_NAMES, ctx.rotation, [] (auto&& entry) { return entry.first; });
+                if (ImGui::BeginCombo("##Rotation", rotation != ROTATION_NAMES.end() ? rotation->second : ""))
+                {
+                    for (auto const& [value, name] : ROTATION_NAMES)
+                    {
+                        if (ImGui::Selectable(name, ctx.rotation == value)) ctx.rotation = value;
+                    }
+                    ImGui::EndCombo();
+                }
+                // only the area moves, it's up to Apply to send it
+                if (ImGui::Button("Optimize Area") && ctx.usage)
+                {
+                    if (auto const area = recommend_tablet_area(*ctx.usage, ctx.areaCoverage / 100.f, ctx.display.width, ctx.display.height))
+                    {
+                        ctx.mappedTabletArea = *area;
+                        ctx.fullArea = false;
+                    }
+                }
             ImGui::EndGroup();
         ImGui::EndGroup();
         ImGui::SameLine();
@@ -385,19 +1177,66 @@ void main_window()
     ImGui::SetCursorPos({ ImGui::GetWindowWidth() - (ImGui::GetCursorPosX() + 200), ImGui::GetWindowHeight() - (ImGui::GetCursorPosX() + 35) });
     if (ImGui::Button("Apply", { 200, 35 }))
     {
-        set_device_area(ctx.device, ctx.mappedTabletArea);
-        set_device_pressure_curve(ctx.device, {
-            ctx.pressureCurvePoints.at(0),
-            ctx.pressureCurvePoints.at(1),
-            ctx.pressureCurvePoints.at(2),
-            ctx.pressureCurvePoints.at(3)
-        });
+        auto const profile = get_pending_profile(ctx);
+
+        apply_profile(ctx.device, profile);
+        save_profile(profile);
+
+        auto const state = std::ranges::find_if(ctx.state.devices, [&] (auto&& entry) { return is_same_device(entry.device, ctx.device); });
+        if (state != ctx.state.devices.end())
+        {
+            state->area = profile.area;
+            state->pressure = profile.pressure;
+            save_state_cache(ctx.state);
+        }
     }
 
     ImGui::End();
+
+    if (ctx.showCanvas) canvas_window(ctx);
+    if (ctx.showDriverSettings && !ctx.device.name.empty()) driver_window(ctx);
+    if (ctx.showDiagnostics) diagnostics_window(ctx);
+}
+
+// GL objects die with the context, their CPU side stays so a reopened window picks up where it left off
+static void release_gl_resources(ApplicationContext& ctx)
+{
+    destroy_heatmap_texture(ctx.heatmapTexture);
+    if (ctx.canvas) destroy_texture(ctx.canvas->texture);
 }
 
-int main()
+static void restore_gl_resources(ApplicationContext& ctx)
+{
+    if (ctx.heatmap)
+    {
+        ctx.heatmapTexture = create_heatmap_texture(*ctx.heatmap);
+        ctx.heatmap->rescaled = true;
+    }
+
+    if (ctx.canvas)
+    {
+        ctx.canvas->texture = create_texture(ctx.canvas->width, ctx.canvas->height);
+        ctx.canvas->dirty = Region { 0, 0, ctx.canvas->width, ctx.canvas->height };
+    }
+}
+
+// how long the loop waits on events after a frame that didn't block on vsync
+static auto constexpr UNSYNCED_FRAME_WAIT = 1.0 / 60.0;
+
+static auto constexpr UPLOAD_MODES = std::array<std::pair<std::string_view, ImGui_ImplOpenGL3_UploadMode>, 3> {{
+    { "per-list", ImGui_ImplOpenGL3_UploadMode_PerList },
+    { "orphaned", ImGui_ImplOpenGL3_UploadMode_Orphaned },
+    { "persistent", ImGui_ImplOpenGL3_UploadMode_Persistent },
+}};
+
+static auto constexpr PARTIAL_REDRAW_MODES = std::array<std::pair<std::string_view, PartialRedraw>, 3> {{
+    { "auto", PartialRedraw::AUTO },
+    { "on", PartialRedraw::ON },
+    { "off", PartialRedraw::OFF },
+}};
+
+// everything here goes away while the window is hidden
+static GLFWwindow* open_main_window(ImFontAtlas& atlas, ImGui_ImplOpenGL3_UploadMode upload)
 {
     glfwInit();
 
@@ -409,50 +1248,364 @@ int main()
     glfwSwapInterval(1);
 
     IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
+    ImGui::CreateContext(&atlas);
 
     ImGui::StyleColorsDark();
 
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 130");
+    ImGui_ImplOpenGL3_SetUploadMode(upload);
+
+    return window;
+}
+
+// the segment would otherwise stay in /dev/shm until reboot. the stylus thread publishes into it, so it stops first
+static void close_live_state(ApplicationContext& ctx)
+{
+    stop_stylus_monitor(ctx.stylusMonitor);
+    close_live_state_publisher(ctx.livePublisher);
+}
+
+static void close_main_window(GLFWwindow* window)
+{
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
+
+static void build_frame(ApplicationContext& ctx, ImFont* font)
+{
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+
+    ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+    ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
+    ImGui::PushFont(font);
+    main_window(ctx);
+    ImGui::PopFont();
+    ImGui::PopStyleVar(1);
+    ImGui::Render();
+}
 
+static void draw_frame(GLFWwindow* window)
+{
     int displayWidth {};
     int displayHeight {};
     glfwGetFramebufferSize(window, &displayWidth, &displayHeight);
+    glViewport(0, 0, displayWidth, displayHeight);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    glfwSwapBuffers(window);
+}
 
-    auto io = ImGui::GetIO();
-    auto* font = io.Fonts->AddFontFromFileTTF(HOME"/resources/fonts/iosevka.ttf", 20.f, nullptr, io.Fonts->GetGlyphRangesDefault());
+// FNV-1a a word at a time, a few GB/s where the byte at a time crc imgui has manages a few hundred MB/s.
+// a collision costs a frame that stays unseen until something else changes
+static std::uint64_t hash_bytes(void const* data, std::size_t size, std::uint64_t digest)
+{
+    auto const* bytes = static_cast<unsigned char const*>(data);
 
-    while (!glfwWindowShouldClose(window))
+    for (; size >= sizeof(std::uint64_t); bytes += sizeof(std::uint64_t), size -= sizeof(std::uint64_t))
     {
-        glfwPollEvents();
+        std::uint64_t word {};
+        std::memcpy(&word, bytes, sizeof(word));
+        digest = (digest ^ word) * 0x100000001b3;
+    }
 
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+    std::uint64_t tail {};
+    std::memcpy(&tail, bytes, size);
+    return (digest ^ tail ^ size) * 0x100000001b3;
+}
 
-        ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
-        ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
-        ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
-        ImGui::PushFont(font);
-        main_window();
-        ImGui::PopFont();
-        ImGui::PopStyleVar(1);
-        ImGui::Render();
+template <class T>
+static std::uint64_t hash_buffer(ImVector<T> const& buffer, std::uint64_t digest)
+{
+    return hash_bytes(buffer.Data, static_cast<std::size_t>(buffer.size_in_bytes()), digest);
+}
 
-        glfwGetFramebufferSize(window, &displayWidth, &displayHeight);
-        glViewport(0, 0, displayWidth, displayHeight);
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+// everything the backend reads to draw the frame, chained list by list so nothing gets copied. commands are
+// zeroed when imgui creates them, so hashing their padding is fine
+static std::uint64_t hash_frame(ImDrawData const& data, int width, int height)
+{
+    std::array<std::uint64_t, 3> const frame { static_cast<std::uint64_t>(width), static_cast<std::uint64_t>(height), get_texture_generation() };
+    auto digest = hash_bytes(frame.data(), sizeof(frame), 0xcbf29ce484222325);
+    digest = hash_bytes(&data.DisplayPos, sizeof(data.DisplayPos), digest);
+    digest = hash_bytes(&data.FramebufferScale, sizeof(data.FramebufferScale), digest);
+
+    for (auto const* list : data.CmdLists)
+    {
+        digest = hash_buffer(list->VtxBuffer, digest);
+        digest = hash_buffer(list->IdxBuffer, digest);
+        digest = hash_buffer(list->CmdBuffer, digest);
+    }
+
+    return digest;
+}
+
+// the back buffer still holds the last frame, only the damage gets cleared and drawn over
+static void draw_damage(std::span<Region const> damage, int width, int height)
+{
+    // no rects would mean everything to the backend
+    if (damage.empty()) return;
+
+    std::vector<ImVec4> rects {};
+
+    glViewport(0, 0, width, height);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glEnable(GL_SCISSOR_TEST);
+
+    for (auto const& region : damage)
+    {
+        glScissor(region.offsetX, height - region.offsetY - region.height, region.width, region.height);
         glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        glfwSwapBuffers(window);
+
+        rects.emplace_back(static_cast<float>(region.offsetX), static_cast<float>(region.offsetY), static_cast<float>(region.offsetX + region.width), static_cast<float>(region.offsetY + region.height));
     }
 
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    glDisable(GL_SCISSOR_TEST);
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    ImGui_ImplOpenGL3_SetDamageRects(rects.data(), static_cast<int>(rects.size()));
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    ImGui_ImplOpenGL3_SetDamageRects(nullptr, 0);
+}
+
+// partial redraw goes by what the window is drawn with, auto turns it on for software GL, which is what Xvnc and x2go
+// sessions have. exposes on a window without a compositor behind it lose what was drawn
+static void attach_main_window(GLFWwindow* window, ApplicationContext& ctx, PartialRedraw partial)
+{
+    auto const wanted = partial == PartialRedraw::ON || (partial == PartialRedraw::AUTO && is_software_renderer());
+    ctx.damagePresenter = wanted ? open_damage_presenter(window) : std::nullopt;
+    ctx.damage.valid = false;
+    ctx.presented.valid = false;
+
+    glfwSetWindowUserPointer(window, &ctx);
+    glfwSetWindowRefreshCallback(window, [] (GLFWwindow* damaged)
+    {
+        static_cast<ApplicationContext*>(glfwGetWindowUserPointer(damaged))->presented.valid = false;
+    });
+}
+
+// draws and swaps unless the frame would come out exactly like the one on screen. with partial redraw on, only what
+// changed is drawn and copied to the front
+static void present_frame(GLFWwindow* window, ApplicationContext& ctx)
+{
+    int displayWidth {};
+    int displayHeight {};
+    glfwGetFramebufferSize(window, &displayWidth, &displayHeight);
+
+    auto& presented = ctx.presented;
+    auto const digest = hash_frame(*ImGui::GetDrawData(), displayWidth, displayHeight);
+
+    if (presented.valid && digest == presented.digest)
+    {
+        presented.unsynced = true;
+        ctx.diagnostics.skippedFrames += 1;
+        return;
+    }
+
+    auto& diagnostics = ctx.diagnostics;
+    diagnostics.presentedFrames += 1;
+
+    if (!ctx.damagePresenter)
+    {
+        draw_frame(window);
+        presented = { digest, true, false };
+        diagnostics.presentedBytes += 4.0 * displayWidth * displayHeight;
+        return;
+    }
+
+    // the back buffer was never swapped, an expose only lost the front one, but the whole window has to be sent again
+    if (!presented.valid) ctx.damage.valid = false;
+
+    auto const damage = update_frame_damage(ctx.damage, *ImGui::GetDrawData(), displayWidth, displayHeight);
+    draw_damage(damage, displayWidth, displayHeight);
+    present_damage(*ctx.damagePresenter, damage, displayHeight);
+    presented = { digest, true, true };
+
+    for (auto const& region : damage) diagnostics.presentedBytes += 4.0 * region.width * region.height;
+}
+
+// the real UI, unthrottled, in every upload mode. what's timed is what the mode changes, from the render call through
+// the swap. LIBGL_ALWAYS_SOFTWARE=1 runs it on llvmpipe
+static int run_render_bench(GLFWwindow* window, ImFont* font, ApplicationContext& ctx, int frames)
+{
+    using Clock = std::chrono::steady_clock;
+    static auto constexpr WARMUP_FRAMES = 30;
+
+    glfwSwapInterval(0);
+    fmt::print("{} frames per mode on {}\n", frames, reinterpret_cast<char const*>(glGetString(GL_RENDERER)));
+
+    for (auto const& [name, requested] : UPLOAD_MODES)
+    {
+        if (ImGui_ImplOpenGL3_SetUploadMode(requested) != requested)
+        {
+            fmt::print("{:<10} unsupported by this context\n", name);
+            continue;
+        }
+
+        std::vector<double> times {};
+        auto uploaded = 0.0;
+
+        for (auto i = 0; i < WARMUP_FRAMES + frames && !glfwWindowShouldClose(window); i += 1)
+        {
+            glfwPollEvents();
+            build_frame(ctx, font);
+
+            auto const start = Clock::now();
+            draw_frame(window);
+            if (i < WARMUP_FRAMES) continue;
+
+            times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            auto const* data = ImGui::GetDrawData();
+            uploaded += static_cast<double>(static_cast<std::size_t>(data->TotalVtxCount) * sizeof(ImDrawVert) + static_cast<std::size_t>(data->TotalIdxCount) * sizeof(ImDrawIdx));
+        }
+
+        if (times.empty()) break;
+
+        std::ranges::sort(times);
+        auto const count = static_cast<double>(times.size());
+        fmt::print("{:<10} mean {:.3f} ms, p50 {:.3f} ms, p95 {:.3f} ms, {:.0f} KiB uploaded per frame\n", name,
+            std::accumulate(times.begin(), times.end(), 0.0) / count, times[times.size() / 2], times[times.size() * 95 / 100], uploaded / count / 1024.0);
+    }
+
+    return 0;
 }
 
+int main(int argc, char** argv)
+{
+    std::vector<std::string_view> const arguments(argv + 1, argv + argc);
+
+    // everything after the flag belongs to the command sent to the daemon
+    if (auto const ctl = std::ranges::find(arguments, "--ctl"); ctl != arguments.end())
+    {
+        return run_control_client(std::span(std::next(ctl), arguments.end()));
+    }
+
+    if (std::ranges::find(arguments, "--daemon") != arguments.end())
+    {
+        FollowMode follow = FollowMode::OFF;
+        if (std::ranges::find(arguments, "--follow-pointer") != arguments.end()) follow = FollowMode::POINTER;
+        if (std::ranges::find(arguments, "--follow-focus") != arguments.end()) follow = FollowMode::FOCUS;
+
+        return run_daemon(follow);
+    }
+
+    auto const getValue = [&] (std::string_view flag) -> std::optional<std::string_view> {
+        auto const argument = std::ranges::find(arguments, flag);
+        if (argument == arguments.end() || std::next(argument) == arguments.end()) return std::nullopt;
+        return *std::next(argument);
+    };
+
+    if (std::ranges::find(arguments, "--self-test") != arguments.end()) return run_hotplug_self_test() + run_math_self_test() == 0 ? 0 : 1;
+
+    if (std::ranges::find(arguments, "--bench-math") != arguments.end())
+    {
+        auto points = 1'000'000zu;
+        if (auto const value = getValue("--bench-math")) std::from_chars(value->data(), value->data() + value->size(), points);
+        return run_math_bench(points);
+    }
+    if (auto const path = getValue("--record")) return run_recorder(*path);
+    if (std::ranges::find(arguments, "--live") != arguments.end()) return run_live_state_viewer();
+    if (auto const path = getValue("--replay")) return run_replay(*path, std::ranges::find(arguments, "--realtime") != arguments.end());
+
+    if (auto const path = getValue("--predict-error"))
+    {
+        auto horizon = 20;
+        if (auto const value = getValue("--horizon")) std::from_chars(value->data(), value->data() + value->size(), horizon);
+        return run_prediction_report(*path, std::int64_t { horizon } * 1'000);
+    }
+
+    // closing the window only hides it, the hotkey or a SIGUSR1 brings it back
+    std::optional<TrayWatcher> tray {};
+    if (std::ranges::find(arguments, "--tray") != arguments.end()) tray = open_tray_watcher(getValue("--tray-hotkey").value_or(DEFAULT_TRAY_HOTKEY));
+
+    ImFontAtlas atlas {};
+    auto* font = atlas.AddFontFromFileTTF(HOME"/resources/fonts/iosevka.ttf", 20.f, nullptr, atlas.GetGlyphRangesDefault());
+    // the atlas outlives every window, so the ttf is only ever rasterized once and then let go of
+    atlas.Build();
+    atlas.ClearInputData();
+
+    // the default is what upstream does, the streaming modes are opt-in
+    auto upload = ImGui_ImplOpenGL3_UploadMode_PerList;
+    if (auto const name = getValue("--upload"))
+    {
+        auto const mode = std::ranges::find(UPLOAD_MODES, *name, [] (auto&& entry) { return entry.first; });
+        if (mode != UPLOAD_MODES.end()) upload = mode->second;
+        else fmt::print(stderr, "[wacacom] unknown upload mode '{}', using per-list\n", *name);
+    }
+
+    auto partial = PartialRedraw::AUTO;
+    if (auto const name = getValue("--partial-redraw"))
+    {
+        auto const mode = std::ranges::find(PARTIAL_REDRAW_MODES, *name, [] (auto&& entry) { return entry.first; });
+        if (mode != PARTIAL_REDRAW_MODES.end()) partial = mode->second;
+        else fmt::print(stderr, "[wacacom] unknown partial redraw mode '{}', using auto\n", *name);
+    }
+
+    ApplicationContext ctx {};
+    auto* window = open_main_window(atlas, upload);
+    attach_main_window(window, ctx, partial);
+
+    if (auto const value = getValue("--bench-frames"))
+    {
+        auto frames = 500;
+        std::from_chars(value->data(), value->data() + value->size(), frames);
+
+        auto const result = run_render_bench(window, font, ctx, frames);
+        release_gl_resources(ctx);
+        close_main_window(window);
+        close_live_state(ctx);
+        return result;
+    }
+
+    while (true)
+    {
+        if (glfwWindowShouldClose(window))
+        {
+            if (!tray) break;
+
+            release_gl_resources(ctx);
+            close_main_window(window);
+
+            ctx.diagnostics.hiddenResidentKib = get_resident_memory_kib();
+            fmt::print(stderr, "[wacacom] hidden, rss {} KiB\n", ctx.diagnostics.hiddenResidentKib);
+
+            // the devices are still followed while hidden, a wake up that isn't for the window is for them
+            while (true)
+            {
+                std::array const wake { ctx.hotplugMonitor.notify, get_property_watcher_fd(ctx.propertyWatcher) };
+                auto const timeout = ctx.devicesRefreshDeadline ? static_cast<int>(HOTPLUG_REFRESH_INTERVAL.count()) : -1;
+                if (wait_for_show_request(*tray, wake, timeout)) break;
+                update_backend(ctx);
+            }
+
+            auto const requested = std::chrono::steady_clock::now();
+            window = open_main_window(atlas, upload);
+            attach_main_window(window, ctx, partial);
+            restore_gl_resources(ctx);
+            ctx.diagnostics.reopenTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - requested).count();
+
+            fmt::print(stderr, "[wacacom] shown in {:.1f} ms, rss {} KiB\n", ctx.diagnostics.reopenTime, get_resident_memory_kib());
+        }
+
+        if (tray && take_show_request(*tray)) glfwFocusWindow(window);
+
+        // nothing waited on vsync for the last frame, so wait for input instead, no longer than a refresh would take
+        if (ctx.presented.unsynced) glfwWaitEventsTimeout(UNSYNCED_FRAME_WAIT);
+        else glfwPollEvents();
+
+        build_frame(ctx, font);
+        present_frame(window, ctx);
+    }
+
+    release_gl_resources(ctx);
+    close_main_window(window);
+    close_live_state(ctx);
+
+    if (tray) close_tray_watcher(*tray);
+}
@@ -0,0 +1,173 @@
+#include "Math.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// the same points on every run, a failure can be run again
+static auto constexpr SEED = 0x5741434fu;
+
+template <class T>
+static std::vector<T> make_random_points(std::size_t count, T min, T max)
+{
+    std::mt19937_64 generator { SEED };
+    std::vector<T> points(count);
+
+    if constexpr (std::is_integral_v<T>)
+    {
+        // the distribution isn't defined for the narrow types
+        std::uniform_int_distribution<std::int64_t> distribution { min, max };
+        std::ranges::generate(points, [&] { return static_cast<T>(distribution(generator)); });
+    }
+    else
+    {
+        std::uniform_real_distribution<T> distribution { min, max };
+        std::ranges::generate(points, [&] { return distribution(generator); });
+    }
+
+    return points;
+}
+
+static std::vector<Fixed> to_fixed(std::vector<std::int32_t> const& raws)
+{
+    std::vector<Fixed> points(raws.size());
+    std::ranges::transform(raws, points.begin(), [] (std::int32_t raw) { return Fixed { raw }; });
+    return points;
+}
+
+template <class T>
+static bool is_batch_exact(std::size_t count, T minA, T maxA, T minB, T maxB)
+{
+    auto const points = make_random_points(count, minA, maxA);
+    std::vector<T> batch(count);
+    lmap<T>(points, batch, minA, maxA, minB, maxB);
+
+    return std::ranges::equal(points, batch, [&] (T x, T mapped) { return lmap(x, minA, maxA, minB, maxB) == mapped; });
+}
+
+static bool is_fixed_batch_exact(std::size_t count, Fixed minA, Fixed maxA, Fixed minB, Fixed maxB)
+{
+    auto const points = to_fixed(make_random_points(count, minA.raw, maxA.raw));
+    std::vector<Fixed> batch(count);
+    lmap(std::span<Fixed const>(points), std::span<Fixed>(batch), minA, maxA, minB, maxB);
+
+    return std::ranges::equal(points, batch, [&] (Fixed x, Fixed mapped) {
+        return lmap<std::int32_t>(x.raw, minA.raw, maxA.raw, minB.raw, maxB.raw) == mapped.raw;
+    });
+}
+
+// the batch folds the ranges into a scale and an offset, which rounds differently than the scalar formula. a few
+// rounding steps of the output range are all it's allowed
+template <class T>
+static bool is_batch_close(std::size_t count, T minA, T maxA, T minB, T maxB)
+{
+    auto const points = make_random_points(count, minA, maxA);
+    std::vector<T> batch(count);
+    lmap<T>(points, batch, minA, maxA, minB, maxB);
+
+    auto const tolerance = 4 * std::numeric_limits<T>::epsilon() * std::max(std::abs(minB), std::abs(maxB));
+    return std::ranges::equal(points, batch, [&] (T x, T mapped) { return std::abs(lmap(x, minA, maxA, minB, maxB) - mapped) <= tolerance; });
+}
+
+int run_math_self_test()
+{
+    auto failures = 0;
+    auto const check = [&] (bool passed, std::string_view what) {
+        if (!passed) failures += 1;
+        fmt::print("{} {}\n", passed ? "ok  " : "FAIL", what);
+    };
+
+    // odd sizes, so the vector loop leaves a tail for the scalar one
+    auto constexpr COUNT = 100'003zu;
+    auto constexpr LOWEST = std::numeric_limits<std::int32_t>::min();
+    auto constexpr HIGHEST = std::numeric_limits<std::int32_t>::max();
+
+    check(is_batch_exact<std::int32_t>(COUNT, 0, 15200, 0, 1920), "int32: tablet units onto a monitor, 64 bit product");
+    check(is_batch_exact<std::int32_t>(COUNT, -40000, 40000, 3840, 0), "int32: a flipped output range");
+    check(is_batch_exact<std::int32_t>(COUNT, LOWEST, HIGHEST, LOWEST, HIGHEST), "int32: the whole range onto itself, 128 bit product");
+    check(is_batch_exact<std::int16_t>(COUNT, -32768, 32767, 0, 1080), "int16");
+    check(is_batch_exact<std::int64_t>(COUNT, -(std::int64_t { 1 } << 40), std::int64_t { 1 } << 40, 0, std::int64_t { 1 } << 50), "int64");
+    check(is_fixed_batch_exact(COUNT, Fixed::from_int(0), Fixed::from_int(15200), Fixed::from_int(0), Fixed::from_int(1920)), "Q16.16: tablet units onto a monitor");
+    check(is_fixed_batch_exact(COUNT, Fixed::from_int(-100), Fixed::from_int(100), Fixed::from_float(1.5f), Fixed::from_float(-0.25f)), "Q16.16: a flipped sub-unit output range");
+    check(is_batch_close<float>(COUNT, 0.f, 15200.f, 0.f, 1920.f), "float: within a few rounding steps of the scalar lmap");
+    check(is_batch_close<float>(COUNT, -1.f, 1.f, 1080.f, 0.f), "float: a flipped output range");
+    check(is_batch_close<double>(COUNT, 0.0, 1.0, -3840.0, 3840.0), "double");
+
+    auto const points = make_random_points(COUNT, 0.f, 270.f);
+    std::vector<float> normalized(COUNT);
+    normalize<float>(points, normalized, 0.f, 270.f);
+    check(std::ranges::equal(points, normalized, [] (float x, float out) { return std::abs(normalize(x, 0.f, 270.f) - out) <= 4 * std::numeric_limits<float>::epsilon(); }),
+        "float: normalize");
+
+    return failures;
+}
+
+// runs `function` until it took long enough to be worth timing, returns nanoseconds per point
+template <class Function>
+static double time_per_point(std::size_t points, Function&& function)
+{
+    auto runs = 0;
+    auto const start = Clock::now();
+
+    do
+    {
+        function();
+        runs += 1;
+    }
+    while (Clock::now() - start < std::chrono::milliseconds(200));
+
+    auto const elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return elapsed / (static_cast<double>(runs) * static_cast<double>(points));
+}
+
+template <class T, class Scalar, class Batch>
+static void bench_kernel(std::string_view name, std::vector<T> const& points, Scalar&& scalar, Batch&& batch)
+{
+    std::vector<T> out(points.size());
+
+    auto const scalarTime = time_per_point(points.size(), [&] {
+        for (auto i = 0zu; i < points.size(); i += 1) out[i] = scalar(points[i]);
+        asm volatile("" : : "r"(out.data()) : "memory");
+    });
+
+    auto const batchTime = time_per_point(points.size(), [&] {
+        batch(std::span<T const>(points), std::span<T>(out));
+        asm volatile("" : : "r"(out.data()) : "memory");
+    });
+
+    fmt::print("{:<8} scalar {:6.3f} ns/point  batch {:6.3f} ns/point  {:5.2f}x\n", name, scalarTime, batchTime, scalarTime / batchTime);
+}
+
+int run_math_bench(std::size_t points)
+{
+    fmt::print("{} points per run\n", points);
+
+    auto const floats = make_random_points(points, 0.f, 15200.f);
+    bench_kernel<float>("float", floats,
+        [] (float x) { return lmap(x, 0.f, 15200.f, 0.f, 1920.f); },
+        [] (auto xs, auto out) { lmap(xs, out, 0.f, 15200.f, 0.f, 1920.f); });
+
+    auto const integers = make_random_points(points, 0, 15200);
+    bench_kernel<int>("int32", integers,
+        [] (int x) { return lmap(x, 0, 15200, 0, 1920); },
+        [] (auto xs, auto out) { lmap(xs, out, 0, 15200, 0, 1920); });
+
+    auto const wide = make_random_points<std::int64_t>(points, 0, std::int64_t { 1 } << 40);
+    bench_kernel<std::int64_t>("int64", wide,
+        [] (std::int64_t x) { return lmap<std::int64_t>(x, 0, std::int64_t { 1 } << 40, 0, 1920); },
+        [] (auto xs, auto out) { lmap<std::int64_t>(xs, out, 0, std::int64_t { 1 } << 40, 0, 1920); });
+
+    auto const fixed = to_fixed(make_random_points(points, 0, Fixed::from_int(15200).raw));
+    bench_kernel<Fixed>("Q16.16", fixed,
+        [] (Fixed x) { return Fixed { lmap<std::int32_t>(x.raw, 0, Fixed::from_int(15200).raw, 0, Fixed::from_int(1920).raw) }; },
+        [] (auto xs, auto out) { lmap(xs, out, Fixed::from_int(0), Fixed::from_int(15200), Fixed::from_int(0), Fixed::from_int(1920)); });
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+#include "Memory.hpp"
+
+#include <ctre.hpp>
+
+#include <fstream>
+#include <string>
+
+long get_resident_memory_kib()
+{
+    std::ifstream status("/proc/self/status");
+    auto const matcher = ctre::search<R"(VmRSS:\s+(\d+)\s+kB)">;
+
+    for (std::string line {}; std::getline(status, line);)
+    {
+        if (auto match = matcher(line)) return match.get<1>().to_number();
+    }
+
+    return 0;
+}
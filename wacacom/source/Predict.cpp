@@ -0,0 +1,107 @@
+#include "Predict.hpp"
+
+#include <algorithm>
+
+// samples further apart than this don't belong to the same motion, the pen was lifted or left proximity
+static auto constexpr MAX_SAMPLE_GAP = std::int64_t { 50'000 };
+// how much of each new velocity estimate the linear mode takes in, reports are jittery at high rates
+static auto constexpr VELOCITY_SMOOTHING = 0.5f;
+// used when the tablet doesn't report its resolution, most of them are around this
+static auto constexpr FALLBACK_UNITS_PER_MM = 200.0;
+
+// the variances are picked in millimeters, a twentieth of a millimeter of jitter and a hand that accelerates at up to
+// a few meters per second squared, and scaled to the tablet
+Predictor make_predictor(Prediction mode, AxisInfo const& axis)
+{
+    auto const unitsPerMm = axis.resolution > 0 ? static_cast<double>(axis.resolution) : FALLBACK_UNITS_PER_MM;
+    auto const jitter = 0.05 * unitsPerMm;
+    auto const acceleration = 5'000.0 * unitsPerMm;
+
+    return { mode, jitter * jitter, acceleration * acceleration, {}, {}, {} };
+}
+
+void reset_predictor(Predictor& predictor)
+{
+    predictor.last.reset();
+    predictor.velocity = {};
+    predictor.axes = {};
+}
+
+static void update_kalman_axis(KalmanAxis& axis, double measurement, double dt, double noise, double acceleration)
+{
+    auto& [position, velocity, p] = axis;
+
+    // predict, the acceleration is white noise integrated over the step
+    position += velocity * dt;
+
+    auto const dt2 = dt * dt;
+    auto const p00 = p[0] + dt * (p[1] + p[2]) + dt2 * p[3] + acceleration * dt2 * dt2 / 4.0;
+    auto const p01 = p[1] + dt * p[3] + acceleration * dt2 * dt / 2.0;
+    auto const p10 = p[2] + dt * p[3] + acceleration * dt2 * dt / 2.0;
+    auto const p11 = p[3] + acceleration * dt2;
+
+    // correct, only the position is measured
+    auto const residual = measurement - position;
+    auto const gainPosition = p00 / (p00 + noise);
+    auto const gainVelocity = p10 / (p00 + noise);
+
+    position += gainPosition * residual;
+    velocity += gainVelocity * residual;
+
+    p = { (1.0 - gainPosition) * p00, (1.0 - gainPosition) * p01, p10 - gainVelocity * p00, p11 - gainVelocity * p01 };
+}
+
+void update_predictor(Predictor& predictor, StylusSample const& sample)
+{
+    auto const x = static_cast<double>(sample.x);
+    auto const y = static_cast<double>(sample.y);
+
+    auto const& last = predictor.last;
+    auto const continued = last && last->contact && sample.contact && sample.time > last->time && sample.time - last->time < MAX_SAMPLE_GAP;
+
+    if (!continued)
+    {
+        reset_predictor(predictor);
+
+        // nothing is known about the velocity yet, so it starts out very uncertain
+        auto const unknown = predictor.acceleration * 1e-2;
+        predictor.axes[0] = { x, 0.0, { predictor.noise, 0.0, 0.0, unknown } };
+        predictor.axes[1] = { y, 0.0, { predictor.noise, 0.0, 0.0, unknown } };
+        predictor.last = sample;
+        return;
+    }
+
+    auto const dt = static_cast<double>(sample.time - last->time) / 1e6;
+
+    if (predictor.mode == Prediction::LINEAR)
+    {
+        Point const velocity { static_cast<float>((x - last->x) / dt), static_cast<float>((y - last->y) / dt) };
+        predictor.velocity.x += (velocity.x - predictor.velocity.x) * VELOCITY_SMOOTHING;
+        predictor.velocity.y += (velocity.y - predictor.velocity.y) * VELOCITY_SMOOTHING;
+    }
+    else if (predictor.mode == Prediction::KALMAN)
+    {
+        update_kalman_axis(predictor.axes[0], x, dt, predictor.noise, predictor.acceleration);
+        update_kalman_axis(predictor.axes[1], y, dt, predictor.noise, predictor.acceleration);
+    }
+
+    predictor.last = sample;
+}
+
+std::optional<Point> predict_position(Predictor const& predictor, std::int64_t horizon)
+{
+    if (predictor.mode == Prediction::OFF || !predictor.last || !predictor.last->contact) return std::nullopt;
+
+    auto const seconds = static_cast<double>(std::clamp(horizon, std::int64_t { 0 }, MAX_PREDICTION_HORIZON)) / 1e6;
+
+    if (predictor.mode == Prediction::LINEAR)
+    {
+        return Point {
+            static_cast<float>(predictor.last->x + static_cast<double>(predictor.velocity.x) * seconds),
+            static_cast<float>(predictor.last->y + static_cast<double>(predictor.velocity.y) * seconds)
+        };
+    }
+
+    auto const& [x, y] = predictor.axes;
+    return Point { static_cast<float>(x.position + x.velocity * seconds), static_cast<float>(y.position + y.velocity * seconds) };
+}
@@ -0,0 +1,122 @@
+#include "Profile.hpp"
+#include "Transform.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+std::filesystem::path get_profiles_path()
+{
+    if (auto const* config = std::getenv("XDG_CONFIG_HOME"); config != nullptr && *config != '\0')
+    {
+        return std::filesystem::path(config) / "wacacom" / "profiles";
+    }
+
+    auto const* home = std::getenv("HOME");
+    assert(home && "HOME WAS NOT SET");
+    return std::filesystem::path(home) / ".config" / "wacacom" / "profiles";
+}
+
+// in the order they're stored in, a rotation is written as its index
+static auto constexpr ROTATIONS = std::array<Rotation, 4> { Rotation::NONE, Rotation::CW, Rotation::HALF, Rotation::CCW };
+
+std::optional<Profile> parse_profile(std::string_view line)
+{
+    auto const matcher = ctre::search<R"x("([^"]+)"\s+"([^"]*)"\s+(-?\d+)\s+(-?\d+)\s+(-?\d+)\s+(-?\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)(?:\s+([01])(?:\s+([0-3])\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+))?)?)x">;
+
+    // profiles written before the aspect flag existed end after the curve, and were applied stretched. those
+    // written before rotation and the output sub-region end after the flag, and took the whole monitor upright
+    auto [expression, device, output, offsetX, offsetY, width, height, minX, minY, maxX, maxY, keepAspect,
+        rotation, outputX, outputY, outputWidth, outputHeight] = matcher(line);
+    if (!expression) return std::nullopt;
+
+    auto const number = [] (auto&& capture) { return capture ? capture.to_number() : 0; };
+
+    return Profile {
+        device.to_string(),
+        output.to_string(),
+        { offsetX.to_number(), offsetY.to_number(), width.to_number(), height.to_number() },
+        {
+            static_cast<float>(minX.to_number()) / 100.f,
+            static_cast<float>(minY.to_number()) / 100.f,
+            static_cast<float>(maxX.to_number()) / 100.f,
+            static_cast<float>(maxY.to_number()) / 100.f
+        },
+        keepAspect.to_view() == "1",
+        ROTATIONS.at(static_cast<std::size_t>(number(rotation))),
+        { number(outputX), number(outputY), number(outputWidth), number(outputHeight) }
+    };
+}
+
+std::string format_profile(Profile const& profile)
+{
+    auto const& [device, output, area, pressure, keepAspect, rotation, outputArea] = profile;
+
+    return fmt::format("\"{}\" \"{}\" {} {} {} {} {} {} {} {} {} {} {} {} {} {}",
+        device, output,
+        area.offsetX, area.offsetY, area.width, area.height,
+        std::round(pressure.minX * 100.f), std::round(pressure.minY * 100.f),
+        std::round(pressure.maxX * 100.f), std::round(pressure.maxY * 100.f),
+        keepAspect ? 1 : 0,
+        std::ranges::find(ROTATIONS, rotation) - ROTATIONS.begin(),
+        outputArea.offsetX, outputArea.offsetY, outputArea.width, outputArea.height
+    );
+}
+
+std::vector<Profile> load_profiles()
+{
+    std::vector<Profile> profiles {};
+
+    std::ifstream file(get_profiles_path());
+
+    for (std::string line {}; std::getline(file, line);)
+    {
+        if (auto profile = parse_profile(line)) profiles.push_back(std::move(*profile));
+    }
+
+    return profiles;
+}
+
+void save_profile(Profile const& profile)
+{
+    auto profiles = fplus::drop_if([&] (auto&& stored) { return stored.device == profile.device; }, load_profiles());
+    profiles.push_back(profile);
+
+    auto const path = get_profiles_path();
+    std::filesystem::create_directories(path.parent_path());
+
+    std::ofstream file(path, std::ios::trunc);
+    assert(file && "COULD NOT WRITE PROFILES");
+
+    for (auto const& stored : profiles)
+    {
+        file << format_profile(stored) << '\n';
+    }
+}
+
+// the area is stored the way the driver takes it, as its two corners. turned a quarter, its width goes up the screen
+Region get_profile_output_region(Profile const& profile, Display const& display)
+{
+    auto const& sub = profile.outputArea;
+    auto const region = sub.width > 0 && sub.height > 0 ? get_sub_region(get_display_region(display), sub) : get_display_region(display);
+    if (!profile.keepAspect) return region;
+
+    auto const& area = profile.area;
+    auto const width = area.width - area.offsetX;
+    auto const height = area.height - area.offsetY;
+    return is_quarter_turn(profile.rotation) ? fit_aspect(region, height, width) : fit_aspect(region, width, height);
+}
+
+void apply_profile(Device const& device, Profile const& profile)
+{
+    set_device_area(device, profile.area);
+    set_device_pressure_curve(device, profile.pressure);
+    if (profile.output.empty()) return;
+
+    auto const display = fplus::find_first_by([&] (auto&& candidate) { return candidate.name == profile.output; }, list_active_displays());
+    if (display.is_nothing()) return;
+
+    set_device_output_from_display_region(device, get_profile_output_region(profile, display.unsafe_get_just()), profile.rotation);
+}
@@ -0,0 +1,132 @@
+#include "ProfileLibrary.hpp"
+#include "Properties.hpp"
+#include "TabletModels.hpp"
+#include "Transform.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+std::filesystem::path get_profile_library_path()
+{
+    return get_profiles_path().parent_path() / "library";
+}
+
+// the library is a list of sections, each one a name, an optional hotkey, the window classes it's picked
+// for when focused ('*' for any) and the same device lines the profiles file has:
+//
+//     [osu! precision]
+//     hotkey = ctrl+alt+3
+//     apps = osu!.exe, osu!
+//     "Wacom Intuos S Pen stylus" "HDMI-1" 0 0 7600 4750 0 0 100 100
+std::vector<NamedProfile> load_profile_library()
+{
+    std::vector<NamedProfile> library {};
+
+    std::ifstream file(get_profile_library_path());
+    auto const sectionMatcher = ctre::match<R"(\s*\[([^\]]+)\]\s*)">;
+    auto const hotkeyMatcher = ctre::match<R"(\s*hotkey\s*=\s*(\S+)\s*)">;
+    auto const applicationsMatcher = ctre::match<R"(\s*apps\s*=\s*(.+))">;
+
+    for (std::string line {}; std::getline(file, line);)
+    {
+        if (auto section = sectionMatcher(line))
+        {
+            library.push_back({ section.get<1>().to_string(), {}, {}, {} });
+        }
+        else if (library.empty())
+        {
+            continue;
+        }
+        else if (auto hotkey = hotkeyMatcher(line))
+        {
+            library.back().hotkey = hotkey.get<1>().to_string();
+        }
+        else if (auto applications = applicationsMatcher(line))
+        {
+            for (auto const& application : fplus::split(',', false, applications.get<1>().to_string()))
+            {
+                library.back().applications.push_back(fplus::trim_whitespace(application));
+            }
+        }
+        else if (auto profile = parse_profile(line))
+        {
+            library.back().profiles.push_back(std::move(*profile));
+        }
+    }
+
+    return library;
+}
+
+bool is_profile_for_application(NamedProfile const& profile, std::string_view application)
+{
+    return fplus::any_by([&] (auto&& candidate) {
+        return std::ranges::equal(candidate, application, [] (char left, char right) { return std::tolower(static_cast<unsigned char>(left)) == std::tolower(static_cast<unsigned char>(right)); });
+    }, profile.applications);
+}
+
+static bool is_valid_profile(Device const& device, Profile const& profile)
+{
+    auto const& [offsetX, offsetY, width, height] = profile.area;
+    if (offsetX < 0 || offsetY < 0 || width <= offsetX || height <= offsetY) return false;
+
+    if (auto const model = find_tablet_model(device.identity.vendor, device.identity.product))
+    {
+        if (width > model->width || height > model->height) return false;
+    }
+
+    auto const& [minX, minY, maxX, maxY] = profile.pressure;
+    return fplus::all_by([] (auto&& value) { return value >= 0.f && value <= 1.f; }, std::vector { minX, minY, maxX, maxY });
+}
+
+std::optional<ApplyPlan> compile_apply_plan(NamedProfile const& profile, std::span<Device const> devices, std::span<Display const> displays)
+{
+    ApplyPlan plan { profile.name, {} };
+
+    auto const screen = get_screen_region(displays);
+
+    for (auto const& entry : profile.profiles)
+    {
+        // devices that aren't plugged in are left out, the plan is compiled again when they show up
+        auto const device = std::ranges::find(devices, entry.device, &Device::name);
+        if (device == devices.end()) continue;
+
+        if (!is_valid_profile(*device, entry)) return std::nullopt;
+
+        PropertySet set { device->id, {} };
+
+        auto const& [offsetX, offsetY, width, height] = entry.area;
+        set_property<AREA_PROPERTY>(set, { offsetX, offsetY, width, height });
+
+        auto const toHundredths = [] (float value) { return static_cast<int>(std::lround(value * 100.f)); };
+        auto const& [minX, minY, maxX, maxY] = entry.pressure;
+        set_property<PRESSURE_CURVE_PROPERTY>(set, { toHundredths(minX), toHundredths(minY), toHundredths(maxX), toHundredths(maxY) });
+
+        if (!entry.output.empty())
+        {
+            auto const output = std::ranges::find(displays, entry.output, &Display::name);
+            if (output == displays.end()) return std::nullopt;
+
+            set_property<TRANSFORM_PROPERTY>(set, get_output_transform(get_profile_output_region(entry, *output), screen, entry.rotation));
+        }
+
+        std::ranges::move(get_property_writes(set), std::back_inserter(plan.writes));
+    }
+
+    return plan;
+}
+
+// drops the writes that would set a property to the value it already has, so switching between two
+// profiles only touches what differs
+ApplyPlan diff_apply_plan(ApplyPlan const& plan, std::span<PropertyWrite const> applied)
+{
+    return { plan.name, fplus::drop_if([&] (auto&& write) { return std::ranges::find(applied, write) != applied.end(); }, plan.writes) };
+}
+
+bool execute_apply_plan(ApplyPlan const& plan)
+{
+    return write_device_properties(plan.writes);
+}
@@ -0,0 +1,126 @@
+#include "Properties.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <string>
+
+static std::string get_property_key(std::string_view name)
+{
+    std::string key {};
+    for (auto const character : name)
+    {
+        if (!std::isspace(static_cast<unsigned char>(character))) key.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(character))));
+    }
+    return key;
+}
+
+std::optional<PropertyDescriptor> find_property_descriptor(std::string_view name)
+{
+    auto const key = get_property_key(name);
+    auto const descriptor = std::ranges::find_if(DRIVER_PROPERTIES, [&] (auto&& candidate) { return get_property_key(candidate.label) == key; });
+    return descriptor != DRIVER_PROPERTIES.end() ? std::optional(*descriptor) : std::nullopt;
+}
+
+// the threshold is a pressure, in whatever range the driver scales the device's pressure to
+PropertyDescriptor get_device_property_descriptor(int deviceId, PropertyDescriptor const& descriptor)
+{
+    auto bounded = descriptor;
+
+    if (descriptor.property == THRESHOLD_PROPERTY.property)
+    {
+        if (auto const maximum = get_valuator_maximum(deviceId, 2)) bounded.maximum = *maximum;
+    }
+
+    return bounded;
+}
+
+static PropertyEntry const* find_property_entry(PropertySet const& set, std::string_view property)
+{
+    auto const entry = std::ranges::find(set.entries, property, &PropertyEntry::property);
+    return entry != set.entries.end() ? &*entry : nullptr;
+}
+
+PropertySet read_device_properties(int deviceId, std::span<PropertyDescriptor const> descriptors)
+{
+    PropertySet set { deviceId, {} };
+
+    for (auto const& descriptor : descriptors)
+    {
+        if (find_property_entry(set, descriptor.property) != nullptr) continue;
+
+        // properties the device doesn't have (an eraser has no area, older drivers lack some) are left out
+        if (auto values = read_device_property(deviceId, get_property_atom(descriptor.property)))
+        {
+            set.entries.push_back({ descriptor.property, values->type, std::move(values->values), false });
+        }
+    }
+
+    return set;
+}
+
+std::vector<PropertyWrite> get_property_writes(PropertySet const& set)
+{
+    std::vector<PropertyWrite> writes {};
+
+    for (auto const& [property, type, values, dirty] : set.entries)
+    {
+        if (dirty) writes.push_back({ set.deviceId, get_property_atom(property), type, values });
+    }
+
+    return writes;
+}
+
+bool write_property_set(PropertySet& set)
+{
+    auto const writes = get_property_writes(set);
+    if (!writes.empty() && !write_device_properties(writes)) return false;
+
+    for (auto& entry : set.entries) entry.dirty = false;
+
+    return true;
+}
+
+std::optional<std::vector<double>> get_property_values(PropertySet const& set, PropertyDescriptor const& descriptor)
+{
+    auto const* entry = find_property_entry(set, descriptor.property);
+    if (entry == nullptr || entry->values.size() < descriptor.offset + descriptor.arity) return std::nullopt;
+
+    std::vector<double> values {};
+
+    for (auto i = descriptor.offset; i < descriptor.offset + descriptor.arity; i += 1)
+    {
+        auto const raw = entry->values[i];
+        values.push_back(descriptor.type == PropertyType::FLOAT ? static_cast<double>(decode_float_property(raw)) : static_cast<double>(raw));
+    }
+
+    return values;
+}
+
+void set_property_values(PropertySet& set, PropertyDescriptor const& descriptor, std::span<double const> values)
+{
+    assert(values.size() == descriptor.arity && "VALUES MUST MATCH THE ARITY OF THE PROPERTY");
+
+    auto entry = std::ranges::find(set.entries, descriptor.property, &PropertyEntry::property);
+
+    // a property that's set whole doesn't need to be read first, one that's shared does, or the settings
+    // next to this one would be overwritten with garbage
+    if (entry == set.entries.end())
+    {
+        auto const length = get_property_length(descriptor.property);
+        assert(descriptor.offset == 0 && descriptor.arity == length && "SHARED PROPERTIES MUST BE READ BEFORE THEY ARE WRITTEN");
+
+        auto const type = get_property_atom(descriptor.type == PropertyType::FLOAT ? "FLOAT" : "INTEGER");
+        entry = set.entries.insert(set.entries.end(), { descriptor.property, type, std::vector<long>(length), false });
+    }
+
+    for (auto i = 0zu; i < descriptor.arity; i += 1)
+    {
+        auto const value = std::clamp(values[i], descriptor.minimum, descriptor.maximum);
+        entry->values.at(descriptor.offset + i) = descriptor.type == PropertyType::FLOAT
+            ? encode_float_property(static_cast<float>(value))
+            : std::lround(value);
+    }
+
+    entry->dirty = true;
+}
@@ -0,0 +1,206 @@
+#include "Recording.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cassert>
+
+// the file is a header and then one record per sample, every field of a record being the difference to the
+// previous sample, zigzag folded and written as a LEB128 varint. consecutive reports barely move, so most
+// fields take a single byte. everything is byte oriented, recordings can move between machines.
+static auto constexpr RECORDING_MAGIC = std::array<std::uint8_t, 4> { 'W', 'C', 'R', 'C' };
+static auto constexpr RECORDING_VERSION = std::uint64_t { 1 };
+static auto constexpr WRITER_BUFFER_SIZE = 64zu * 1024;
+
+static std::uint64_t zigzag_encode(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+static std::int64_t zigzag_decode(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+static void write_varint(std::vector<std::uint8_t>& buffer, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+
+    buffer.push_back(static_cast<std::uint8_t>(value));
+}
+
+static std::optional<std::uint64_t> read_varint(std::span<std::uint8_t const> data, std::size_t& offset)
+{
+    std::uint64_t value {};
+
+    for (auto shift = 0u; offset < data.size() && shift < 64; shift += 7)
+    {
+        auto const byte = data[offset++];
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+
+    return std::nullopt;
+}
+
+static void write_signed(std::vector<std::uint8_t>& buffer, std::int64_t value)
+{
+    write_varint(buffer, zigzag_encode(value));
+}
+
+static std::optional<std::int64_t> read_signed(std::span<std::uint8_t const> data, std::size_t& offset)
+{
+    auto const value = read_varint(data, offset);
+    if (!value) return std::nullopt;
+    return zigzag_decode(*value);
+}
+
+static void flush_recording_writer(RecordingWriter& writer)
+{
+    writer.file.write(reinterpret_cast<char const*>(writer.buffer.data()), static_cast<std::streamsize>(writer.buffer.size()));
+    writer.buffer.clear();
+}
+
+RecordingWriter open_recording_writer(std::filesystem::path const& path, RecordingHeader const& header)
+{
+    RecordingWriter writer { std::ofstream(path, std::ios::binary | std::ios::trunc), {}, {}, 0 };
+    assert(writer.file && "COULD NOT OPEN RECORDING");
+
+    writer.buffer.reserve(WRITER_BUFFER_SIZE + 64);
+    writer.buffer.insert(writer.buffer.end(), RECORDING_MAGIC.begin(), RECORDING_MAGIC.end());
+    write_varint(writer.buffer, RECORDING_VERSION);
+
+    write_varint(writer.buffer, header.device.size());
+    writer.buffer.insert(writer.buffer.end(), header.device.begin(), header.device.end());
+
+    for (auto const& axis : { header.x, header.y, header.pressure })
+    {
+        write_signed(writer.buffer, axis.minimum);
+        write_signed(writer.buffer, axis.maximum);
+        write_signed(writer.buffer, axis.resolution);
+    }
+
+    return writer;
+}
+
+void write_recording_sample(RecordingWriter& writer, StylusSample const& sample)
+{
+    auto const& last = writer.last;
+
+    write_signed(writer.buffer, sample.time - last.time);
+    write_signed(writer.buffer, sample.x - last.x);
+    write_signed(writer.buffer, sample.y - last.y);
+    write_signed(writer.buffer, sample.pressure - last.pressure);
+    write_signed(writer.buffer, sample.tiltX - last.tiltX);
+    write_signed(writer.buffer, sample.tiltY - last.tiltY);
+    writer.buffer.push_back(static_cast<std::uint8_t>(sample.contact));
+
+    writer.last = sample;
+    writer.samples += 1;
+
+    if (writer.buffer.size() >= WRITER_BUFFER_SIZE) flush_recording_writer(writer);
+}
+
+void close_recording_writer(RecordingWriter& writer)
+{
+    flush_recording_writer(writer);
+    writer.file.close();
+}
+
+std::optional<Recording> open_recording(std::filesystem::path const& path)
+{
+    auto const fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return std::nullopt;
+
+    struct stat status {};
+    fstat(fd, &status);
+    auto const size = static_cast<std::size_t>(status.st_size);
+
+    auto* mapping = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) return std::nullopt;
+
+    // replay reads it front to back exactly once
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    Recording recording { {}, { static_cast<std::uint8_t const*>(mapping), size }, 0 };
+    auto& offset = recording.samplesOffset;
+
+    auto const isValid = [&] {
+        if (!std::ranges::equal(recording.data.first(std::min(size, RECORDING_MAGIC.size())), RECORDING_MAGIC)) return false;
+        offset = RECORDING_MAGIC.size();
+
+        if (read_varint(recording.data, offset) != RECORDING_VERSION) return false;
+
+        auto const length = read_varint(recording.data, offset);
+        if (!length || *length > size - offset) return false;
+        recording.header.device.assign(reinterpret_cast<char const*>(recording.data.data() + offset), *length);
+        offset += *length;
+
+        for (auto* axis : { &recording.header.x, &recording.header.y, &recording.header.pressure })
+        {
+            auto const minimum = read_signed(recording.data, offset);
+            auto const maximum = read_signed(recording.data, offset);
+            auto const resolution = read_signed(recording.data, offset);
+            if (!minimum || !maximum || !resolution) return false;
+
+            *axis = { static_cast<int>(*minimum), static_cast<int>(*maximum), static_cast<int>(*resolution) };
+        }
+
+        return true;
+    }();
+
+    if (!isValid)
+    {
+        close_recording(recording);
+        return std::nullopt;
+    }
+
+    return recording;
+}
+
+void close_recording(Recording& recording)
+{
+    if (!recording.data.empty()) munmap(const_cast<std::uint8_t*>(recording.data.data()), recording.data.size());
+    recording.data = {};
+}
+
+RecordingCursor get_recording_cursor(Recording const& recording)
+{
+    return { recording.samplesOffset, {} };
+}
+
+std::optional<StylusSample> read_recording_sample(Recording const& recording, RecordingCursor& cursor)
+{
+    auto& offset = cursor.offset;
+    auto& last = cursor.last;
+
+    auto const time = read_signed(recording.data, offset);
+    auto const x = read_signed(recording.data, offset);
+    auto const y = read_signed(recording.data, offset);
+    auto const pressure = read_signed(recording.data, offset);
+    auto const tiltX = read_signed(recording.data, offset);
+    auto const tiltY = read_signed(recording.data, offset);
+
+    // a recording cut short by a crash ends at its last whole sample
+    if (!time || !x || !y || !pressure || !tiltX || !tiltY || offset >= recording.data.size()) return std::nullopt;
+
+    last = {
+        last.time + *time,
+        last.x + static_cast<int>(*x),
+        last.y + static_cast<int>(*y),
+        last.pressure + static_cast<int>(*pressure),
+        last.tiltX + static_cast<int>(*tiltX),
+        last.tiltY + static_cast<int>(*tiltY),
+        recording.data[offset++] != 0
+    };
+
+    return last;
+}
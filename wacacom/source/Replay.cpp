@@ -0,0 +1,303 @@
+#include "Replay.hpp"
+#include "Display.hpp"
+#include "Predict.hpp"
+#include "Profile.hpp"
+#include "Recording.hpp"
+#include "Stylus.hpp"
+#include "Transform.hpp"
+#include "Usage.hpp"
+
+#include <fmt/format.h>
+
+#include <poll.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// used when the recorded device has no stored profile, or its output isn't connected
+static auto constexpr FALLBACK_OUTPUT = Region { 0, 0, 1920, 1080 };
+// samples mapped per call, enough for the batch kernels to pay off and few enough to stay in cache
+static auto constexpr REPLAY_BATCH = 4096zu;
+
+static volatile std::sig_atomic_t shouldStop = 0;
+
+int run_recorder(std::filesystem::path const& path)
+{
+    auto const tablets = discover_tablet_nodes(scan_input_nodes());
+    auto const stylus = std::ranges::find_if(tablets, [] (auto&& tablet) { return tablet.device.type == DeviceType::STYLUS; });
+
+    if (stylus == tablets.end())
+    {
+        fmt::print(stderr, "no stylus was found\n");
+        return 1;
+    }
+
+    auto reader = open_stylus_reader(stylus->device.node);
+    if (reader.fd == -1)
+    {
+        fmt::print(stderr, "could not open {}, is it readable by this user?\n", stylus->device.node);
+        return 1;
+    }
+
+    std::signal(SIGINT, [] (int) { shouldStop = 1; });
+    std::signal(SIGTERM, [] (int) { shouldStop = 1; });
+
+    auto writer = open_recording_writer(path, { stylus->device.name, stylus->x, stylus->y, stylus->pressure });
+
+    fmt::print(stderr, "recording '{}' from {} to {}, stop with ctrl+c\n", stylus->device.name, stylus->device.node, path.string());
+
+    auto failed = false;
+
+    // the process sleeps in poll between reports, a sample costs a read and a few bytes of encoding
+    while (!shouldStop)
+    {
+        pollfd fd { reader.fd, POLLIN, 0 };
+        if (poll(&fd, 1, -1) == -1)
+        {
+            // ctrl+c lands here too, shouldStop ends the loop
+            if (errno == EINTR) continue;
+
+            fmt::print(stderr, "could not wait on {}: {}\n", stylus->device.node, std::strerror(errno));
+            failed = true;
+            break;
+        }
+
+        for (auto const& sample : read_stylus_samples(reader)) write_recording_sample(writer, sample);
+    }
+
+    close_recording_writer(writer);
+    close_stylus_reader(reader);
+
+    auto const bytes = std::filesystem::file_size(path);
+    fmt::print(stderr, "wrote {} samples in {} bytes ({:.2f} bytes per sample)\n",
+        writer.samples, bytes, writer.samples > 0 ? static_cast<double>(bytes) / static_cast<double>(writer.samples) : 0.0);
+
+    return failed ? 1 : 0;
+}
+
+// the recorded device's stored profile is what the samples go through, so a change to the area or the curve
+// shows up as a different digest on the same recording
+static StylusMapping get_replay_mapping(RecordingHeader const& header)
+{
+    Region area { header.x.minimum, header.y.minimum, header.x.maximum, header.y.maximum };
+    Pressure curve { 0.f, 0.f, 1.f, 1.f };
+    auto output = FALLBACK_OUTPUT;
+
+    auto const displays = list_active_displays();
+    auto const primary = std::ranges::find_if(displays, [] (auto&& display) { return display.primary; });
+    if (primary != displays.end()) output = get_display_region(*primary);
+
+    auto const profiles = load_profiles();
+    if (auto const profile = std::ranges::find(profiles, header.device, &Profile::device); profile != profiles.end())
+    {
+        area = profile->area;
+        curve = profile->pressure;
+
+        auto const display = std::ranges::find(displays, profile->output, &Display::name);
+        if (display != displays.end()) output = get_profile_output_region(*profile, *display);
+    }
+
+    return make_stylus_mapping(area, output, curve, header.pressure);
+}
+
+int run_replay(std::filesystem::path const& path, bool realtime)
+{
+    auto recording = open_recording(path);
+    if (!recording)
+    {
+        fmt::print(stderr, "{} is not a recording\n", path.string());
+        return 1;
+    }
+
+    auto const mapping = get_replay_mapping(recording->header);
+    auto usage = make_usage_sketch(recording->header.x, recording->header.y);
+
+    auto samples = 0zu;
+    auto contacts = 0zu;
+    auto pressureSum = 0.0;
+    auto digest = std::uint64_t { 0xcbf29ce484222325 };
+    std::optional<std::int64_t> firstTime {};
+    std::int64_t lastTime {};
+
+    // samples go through the mapping a batch at a time, except in real time where each one is due on its own
+    std::vector<StylusSample> batch {};
+    std::vector<MappedSample> mapped {};
+
+    auto const flush = [&] {
+        mapped.resize(batch.size());
+        map_stylus_samples(mapping, batch, mapped);
+        add_usage_samples(usage, batch);
+
+        for (auto const& sample : mapped)
+        {
+            samples += 1;
+            if (sample.contact)
+            {
+                contacts += 1;
+                pressureSum += static_cast<double>(sample.pressure);
+            }
+
+            // FNV-1a over what came out, two runs only agree if every sample mapped to the same place
+            for (auto const value : { sample.x, sample.y, sample.pressure })
+            {
+                digest = (digest ^ std::bit_cast<std::uint32_t>(value)) * 0x100000001b3;
+            }
+        }
+
+        batch.clear();
+    };
+
+    auto const start = Clock::now();
+    auto cursor = get_recording_cursor(*recording);
+
+    while (auto const sample = read_recording_sample(*recording, cursor))
+    {
+        if (!firstTime) firstTime = sample->time;
+        lastTime = sample->time;
+
+        if (realtime) std::this_thread::sleep_until(start + std::chrono::microseconds(sample->time - *firstTime));
+
+        batch.push_back(*sample);
+        if (realtime || batch.size() == REPLAY_BATCH) flush();
+    }
+
+    flush();
+
+    auto const elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    auto const recorded = firstTime ? static_cast<double>(lastTime - *firstTime) / 1e6 : 0.0;
+
+    fmt::print("device:    {}\n", recording->header.device);
+    fmt::print("samples:   {} ({} in contact)\n", samples, contacts);
+    fmt::print("recorded:  {:.3f} s\n", recorded);
+    fmt::print("replayed:  {:.3f} s ({:.0f} samples/s)\n", elapsed, elapsed > 0.0 ? static_cast<double>(samples) / elapsed : 0.0);
+    fmt::print("area:      {} {} {} {}\n", mapping.area.offsetX, mapping.area.offsetY, mapping.area.width, mapping.area.height);
+    fmt::print("output:    {}x{}+{}+{}\n", mapping.output.width, mapping.output.height, mapping.output.offsetX, mapping.output.offsetY);
+    fmt::print("pressure:  {:.4f} mean while in contact\n", contacts > 0 ? pressureSum / static_cast<double>(contacts) : 0.0);
+    fmt::print("digest:    {:016x}\n", digest);
+
+    if (auto const area = recommend_tablet_area(usage, 0.95f, mapping.output.width, mapping.output.height))
+    {
+        fmt::print("suggested: {} {} {} {} (95% of strokes)\n", area->offsetX, area->offsetY, area->width, area->height);
+    }
+
+    close_recording(*recording);
+
+    return 0;
+}
+
+struct PredictionScore
+{
+    std::vector<double> errors; // tablet units
+    double overshoot;
+};
+
+// every contact sample gets a prediction `horizon` ahead, which is held against where the pen actually was
+// by then. without prediction that distance is just the lag, so it's the baseline the others are measured to.
+static PredictionScore score_prediction(std::span<StylusSample const> samples, std::span<std::size_t const> strokes, Prediction mode, AxisInfo const& axis, std::int64_t horizon)
+{
+    PredictionScore score {};
+    auto predictor = make_predictor(mode, axis);
+    auto ahead = 0zu;
+
+    for (auto i = 0zu; i < samples.size(); i += 1)
+    {
+        auto const& sample = samples[i];
+        update_predictor(predictor, sample);
+        if (!sample.contact) continue;
+
+        auto const target = sample.time + horizon;
+        ahead = std::max(ahead, i);
+        while (ahead < samples.size() && samples[ahead].time < target && strokes[ahead] == strokes[i]) ahead += 1;
+
+        // the stroke ended before the horizon did, there's nothing to compare against
+        if (ahead == samples.size() || strokes[ahead] != strokes[i] || ahead == i) continue;
+
+        auto const& before = samples[ahead - 1];
+        auto const& after = samples[ahead];
+        auto const t = static_cast<double>(target - before.time) / static_cast<double>(std::max(after.time - before.time, std::int64_t { 1 }));
+        auto const actualX = before.x + (after.x - before.x) * t;
+        auto const actualY = before.y + (after.y - before.y) * t;
+
+        auto const predicted = predict_position(predictor, horizon).value_or(Point { static_cast<float>(sample.x), static_cast<float>(sample.y) });
+        auto const errorX = static_cast<double>(predicted.x) - actualX;
+        auto const errorY = static_cast<double>(predicted.y) - actualY;
+        score.errors.push_back(std::hypot(errorX, errorY));
+
+        // how far past the actual position the guess went, along the direction the pen was moving
+        auto const motionX = actualX - sample.x;
+        auto const motionY = actualY - sample.y;
+        auto const motion = std::hypot(motionX, motionY);
+        if (motion > 0.0) score.overshoot += std::max(0.0, (errorX * motionX + errorY * motionY) / motion);
+    }
+
+    return score;
+}
+
+int run_prediction_report(std::filesystem::path const& path, std::int64_t horizon)
+{
+    auto recording = open_recording(path);
+    if (!recording)
+    {
+        fmt::print(stderr, "{} is not a recording\n", path.string());
+        return 1;
+    }
+
+    std::vector<StylusSample> samples {};
+    auto cursor = get_recording_cursor(*recording);
+    while (auto const sample = read_recording_sample(*recording, cursor)) samples.push_back(*sample);
+
+    // a new stroke starts with every touch down and with every gap in the reports
+    std::vector<std::size_t> strokes(samples.size());
+    for (auto i = 1zu; i < samples.size(); i += 1)
+    {
+        auto const& previous = samples[i - 1];
+        auto const& current = samples[i];
+        auto const continued = previous.contact && current.contact && current.time - previous.time < MAX_PREDICTION_HORIZON;
+        strokes[i] = strokes[i - 1] + (continued ? 0 : 1);
+    }
+
+    auto const& axis = recording->header.x;
+    auto const scale = axis.resolution > 0 ? 1.0 / axis.resolution : 1.0;
+    auto const unit = axis.resolution > 0 ? "mm" : "units";
+
+    fmt::print("device:    {}\n", recording->header.device);
+    fmt::print("horizon:   {:.1f} ms\n", static_cast<double>(horizon) / 1e3);
+    fmt::print("{:<10}{:>10}{:>10}{:>12}{:>10}\n", "mode", fmt::format("mean {}", unit), fmt::format("p95 {}", unit), "overshoot", "hidden");
+
+    std::optional<double> baseline {};
+
+    for (auto const& [mode, name] : { std::pair { Prediction::OFF, "off" }, { Prediction::LINEAR, "linear" }, { Prediction::KALMAN, "kalman" } })
+    {
+        auto score = score_prediction(samples, strokes, mode, axis, horizon);
+
+        if (score.errors.empty())
+        {
+            fmt::print(stderr, "no stroke in the recording is longer than the horizon\n");
+            break;
+        }
+
+        auto const count = static_cast<double>(score.errors.size());
+        auto const mean = std::accumulate(score.errors.begin(), score.errors.end(), 0.0) / count;
+        auto const percentile = score.errors.begin() + static_cast<std::ptrdiff_t>(0.95 * (count - 1));
+        std::ranges::nth_element(score.errors, percentile);
+
+        if (!baseline) baseline = mean;
+
+        fmt::print("{:<10}{:>10.3f}{:>10.3f}{:>12.3f}{:>9.0f}%\n",
+            name, mean * scale, *percentile * scale, score.overshoot / count * scale, *baseline > 0.0 ? (1.0 - mean / *baseline) * 100.0 : 0.0);
+    }
+
+    close_recording(*recording);
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include "StateCache.hpp"
+#include "Hotplug.hpp"
+#include "TabletModels.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+
+static auto constexpr STATE_CACHE_MAGIC = std::uint32_t { 0x4d434357 }; // "WCCM"
+static auto constexpr STATE_CACHE_VERSION = std::uint32_t { 2 };
+
+// the cache never leaves the machine that wrote it, so everything is stored in native byte order
+template <class T>
+static void write_value(std::ostream& stream, T const& value) requires (std::is_arithmetic_v<T>)
+{
+    stream.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+static void write_value(std::ostream& stream, std::string const& value)
+{
+    write_value(stream, static_cast<std::uint32_t>(value.size()));
+    stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+static void write_value(std::ostream& stream, Region const& region)
+{
+    write_value(stream, region.offsetX);
+    write_value(stream, region.offsetY);
+    write_value(stream, region.width);
+    write_value(stream, region.height);
+}
+
+template <class T>
+static void read_value(std::istream& stream, T& value) requires (std::is_arithmetic_v<T>)
+{
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+static void read_value(std::istream& stream, std::string& value)
+{
+    std::uint32_t size {};
+    read_value(stream, size);
+    if (!stream || size > 4096) return stream.setstate(std::ios::failbit);
+    value.resize(size);
+    stream.read(value.data(), static_cast<std::streamsize>(size));
+}
+
+static void read_value(std::istream& stream, Region& region)
+{
+    read_value(stream, region.offsetX);
+    read_value(stream, region.offsetY);
+    read_value(stream, region.width);
+    read_value(stream, region.height);
+}
+
+std::filesystem::path get_state_cache_path()
+{
+    if (auto const* cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr && *cache != '\0')
+    {
+        return std::filesystem::path(cache) / "wacacom" / "state";
+    }
+
+    auto const* home = std::getenv("HOME");
+    assert(home && "HOME WAS NOT SET");
+    return std::filesystem::path(home) / ".cache" / "wacacom" / "state";
+}
+
+std::optional<ApplicationState> load_state_cache()
+{
+    std::ifstream file(get_state_cache_path(), std::ios::binary);
+    if (!file) return std::nullopt;
+
+    std::uint32_t magic {};
+    std::uint32_t version {};
+    read_value(file, magic);
+    read_value(file, version);
+    if (!file || magic != STATE_CACHE_MAGIC || version != STATE_CACHE_VERSION) return std::nullopt;
+
+    ApplicationState state {};
+
+    std::uint32_t displayCount {};
+    read_value(file, displayCount);
+    for (auto i = 0u; file && i < displayCount; i += 1)
+    {
+        Display display {};
+        std::uint8_t primary {};
+        read_value(file, display.id);
+        read_value(file, primary);
+        read_value(file, display.width);
+        read_value(file, display.height);
+        read_value(file, display.offsetX);
+        read_value(file, display.offsetY);
+        read_value(file, display.name);
+        display.primary = primary != 0;
+        state.displays.push_back(display);
+    }
+
+    std::uint32_t deviceCount {};
+    read_value(file, deviceCount);
+    for (auto i = 0u; file && i < deviceCount; i += 1)
+    {
+        DeviceState device {};
+        std::string type {};
+        read_value(file, device.device.name);
+        read_value(file, device.device.id);
+        read_value(file, type);
+        read_value(file, device.device.identity.vendor);
+        read_value(file, device.device.identity.product);
+        read_value(file, device.device.identity.serial);
+        read_value(file, device.device.node);
+        read_value(file, device.entireArea);
+        read_value(file, device.area);
+        read_value(file, device.pressure.minX);
+        read_value(file, device.pressure.minY);
+        read_value(file, device.pressure.maxX);
+        read_value(file, device.pressure.maxY);
+        if (file) device.device.type = DeviceType::from_string(type);
+        state.devices.push_back(device);
+    }
+
+    if (!file) return std::nullopt;
+
+    return state;
+}
+
+void save_state_cache(ApplicationState const& state)
+{
+    auto const path = get_state_cache_path();
+    std::filesystem::create_directories(path.parent_path());
+
+    // written next to the real one first, so a crash halfway through never leaves a torn cache behind
+    auto const temporary = std::filesystem::path(path).concat(".tmp");
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) return;
+
+        write_value(file, STATE_CACHE_MAGIC);
+        write_value(file, STATE_CACHE_VERSION);
+
+        write_value(file, static_cast<std::uint32_t>(state.displays.size()));
+        for (auto const& display : state.displays)
+        {
+            write_value(file, display.id);
+            write_value(file, static_cast<std::uint8_t>(display.primary));
+            write_value(file, display.width);
+            write_value(file, display.height);
+            write_value(file, display.offsetX);
+            write_value(file, display.offsetY);
+            write_value(file, display.name);
+        }
+
+        write_value(file, static_cast<std::uint32_t>(state.devices.size()));
+        for (auto const& [device, entireArea, area, pressure] : state.devices)
+        {
+            write_value(file, device.name);
+            write_value(file, device.id);
+            write_value(file, device.type.to_string());
+            write_value(file, device.identity.vendor);
+            write_value(file, device.identity.product);
+            write_value(file, device.identity.serial);
+            write_value(file, device.node);
+            write_value(file, entireArea);
+            write_value(file, area);
+            write_value(file, pressure.minX);
+            write_value(file, pressure.minY);
+            write_value(file, pressure.maxX);
+            write_value(file, pressure.maxY);
+        }
+
+        if (!file) return;
+    }
+
+    std::error_code error {};
+    std::filesystem::rename(temporary, path, error);
+}
+
+ApplicationState query_application_state()
+{
+    ApplicationState state {};
+
+    state.displays = list_active_displays();
+
+    state.tabletNodes = discover_tablet_nodes(scan_input_nodes());
+
+    auto devices = fplus::transform([] (auto&& tablet) { return tablet.device; },
+        fplus::keep_if([] (auto&& tablet) { return tablet.device.type == DeviceType::STYLUS && tablet.device.id != -1; }, state.tabletNodes)
+    );
+
+    if (devices.empty()) devices = get_drawing_devices();
+
+    // the sensor size of a model that isn't known can only be found by resetting the driver's area, which is left
+    // to the main thread, an empty area stands for not known
+    for (auto const& device : devices)
+    {
+        auto const model = find_tablet_model(device.identity.vendor, device.identity.product);
+        auto const entireArea = model ? get_tablet_model_area(*model) : Region {};
+        state.devices.push_back({ device, entireArea, get_device_area(device), get_device_pressure_curve(device) });
+    }
+
+    return state;
+}
+
+std::optional<DeviceState> find_device_state(ApplicationState const& state, Device const& device)
+{
+    auto const found = std::ranges::find_if(state.devices, [&] (auto&& candidate) { return is_same_device(candidate.device, device); });
+
+    if (found == state.devices.end()) return std::nullopt;
+
+    return *found;
+}
+
+// the same physical tool, whatever X id it currently has
+bool is_same_device(Device const& a, Device const& b)
+{
+    return a.identity == b.identity && a.type == b.type && a.name == b.name;
+}
@@ -0,0 +1,250 @@
+#include "Stylus.hpp"
+#include "LiveState.hpp"
+#include "Math.hpp"
+
+#include <linux/input.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <utility>
+#include <vector>
+
+// pressure tables are one entry per level, anything beyond this is a broken range rather than a real pen
+static auto constexpr MAX_PRESSURE_LEVELS = 65536;
+// a few seconds worth of reports, for when nobody polls the monitor (e.g. while minimized)
+static auto constexpr MAX_PENDING_SAMPLES = 4096zu;
+
+StylusReader open_stylus_reader(std::string const& node)
+{
+    return { open(node.data(), O_RDONLY | O_NONBLOCK | O_CLOEXEC), false, {} };
+}
+
+void close_stylus_reader(StylusReader& reader)
+{
+    if (reader.fd != -1) close(reader.fd);
+    reader.fd = -1;
+}
+
+// after the kernel drops events the only way back to a consistent state is asking for it
+static void resync_stylus_reader(StylusReader& reader)
+{
+    auto const getValue = [&] (unsigned axis) {
+        input_absinfo info {};
+        return ioctl(reader.fd, EVIOCGABS(axis), &info) == -1 ? 0 : info.value;
+    };
+
+    reader.current.x = getValue(ABS_X);
+    reader.current.y = getValue(ABS_Y);
+    reader.current.pressure = getValue(ABS_PRESSURE);
+    reader.current.tiltX = getValue(ABS_TILT_X);
+    reader.current.tiltY = getValue(ABS_TILT_Y);
+
+    std::array<unsigned long, (KEY_CNT + sizeof(unsigned long) * CHAR_BIT - 1) / (sizeof(unsigned long) * CHAR_BIT)> keys {};
+    ioctl(reader.fd, EVIOCGKEY(sizeof(keys)), keys.data());
+    auto constexpr BITS = sizeof(unsigned long) * CHAR_BIT;
+    reader.current.contact = (keys.at(BTN_TOUCH / BITS) >> (BTN_TOUCH % BITS)) & 1ul;
+}
+
+// drains whatever is queued on the node without blocking, a sample is emitted on every SYN_REPORT
+std::vector<StylusSample> read_stylus_samples(StylusReader& reader)
+{
+    std::vector<StylusSample> samples {};
+    if (reader.fd == -1) return samples;
+
+    std::array<input_event, 64> events {};
+
+    while (true)
+    {
+        auto const size = read(reader.fd, events.data(), sizeof(events));
+        if (size <= 0) break;
+
+        for (auto const& event : std::span(events.data(), static_cast<size_t>(size) / sizeof(input_event)))
+        {
+            if (event.type == EV_SYN && event.code == SYN_DROPPED)
+            {
+                reader.dropped = true;
+            }
+            else if (event.type == EV_SYN && event.code == SYN_REPORT)
+            {
+                if (std::exchange(reader.dropped, false)) resync_stylus_reader(reader);
+
+                reader.current.time = static_cast<std::int64_t>(event.input_event_sec) * 1'000'000 + event.input_event_usec;
+                samples.push_back(reader.current);
+            }
+            else if (reader.dropped)
+            {
+                continue;
+            }
+            else if (event.type == EV_ABS)
+            {
+                if (event.code == ABS_X) reader.current.x = event.value;
+                else if (event.code == ABS_Y) reader.current.y = event.value;
+                else if (event.code == ABS_PRESSURE) reader.current.pressure = event.value;
+                else if (event.code == ABS_TILT_X) reader.current.tiltX = event.value;
+                else if (event.code == ABS_TILT_Y) reader.current.tiltY = event.value;
+            }
+            else if (event.type == EV_KEY && event.code == BTN_TOUCH)
+            {
+                reader.current.contact = event.value != 0;
+            }
+        }
+    }
+
+    return samples;
+}
+
+void start_stylus_monitor(StylusMonitor& monitor, std::string const& node, LiveStatePublisher* publisher)
+{
+    stop_stylus_monitor(monitor);
+    monitor.node = node;
+
+    monitor.thread = std::jthread([&monitor, node, publisher] (std::stop_token token) {
+        auto reader = open_stylus_reader(node);
+        if (reader.fd == -1) return;
+
+        auto const wake = eventfd(0, EFD_CLOEXEC);
+        assert(wake != -1 && "COULD NOT CREATE EVENTFD");
+
+        std::stop_callback const stop(token, [wake] {
+            std::uint64_t const value = 1;
+            [[maybe_unused]] auto const written = write(wake, &value, sizeof(value));
+        });
+
+        while (!token.stop_requested())
+        {
+            std::array<pollfd, 2> fds {{ { reader.fd, POLLIN, 0 }, { wake, POLLIN, 0 } }};
+            if (poll(fds.data(), fds.size(), -1) == -1)
+            {
+                // anything but a signal won't go away by polling again, the thread would only spin on it
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            if (fds[0].revents & (POLLERR | POLLHUP)) break;
+            if (!(fds[0].revents & POLLIN)) continue;
+
+            auto samples = read_stylus_samples(reader);
+            if (publisher != nullptr) publish_live_samples(*publisher, samples);
+
+            std::scoped_lock const lock(monitor.mutex);
+            monitor.samples.insert(monitor.samples.end(), samples.begin(), samples.end());
+            if (monitor.samples.size() > MAX_PENDING_SAMPLES)
+            {
+                monitor.samples.erase(monitor.samples.begin(), monitor.samples.end() - MAX_PENDING_SAMPLES);
+            }
+        }
+
+        close(wake);
+        close_stylus_reader(reader);
+    });
+}
+
+void stop_stylus_monitor(StylusMonitor& monitor)
+{
+    if (monitor.thread.joinable())
+    {
+        monitor.thread.request_stop();
+        monitor.thread.join();
+    }
+
+    monitor.node.clear();
+    monitor.samples.clear();
+}
+
+std::vector<StylusSample> poll_stylus_samples(StylusMonitor& monitor)
+{
+    std::scoped_lock const lock(monitor.mutex);
+    return std::exchange(monitor.samples, {});
+}
+
+// the driver's curve is a cubic bezier from (0, 0) to (1, 1) with the two stored points as its controls.
+// x(t) only ever grows, so t is found by bisection and y(t) is the result
+float evaluate_pressure_curve(Pressure const& curve, float pressure)
+{
+    auto const bezier = [] (float t, float first, float second) {
+        auto const u = 1.f - t;
+        return 3.f * u * u * t * first + 3.f * u * t * t * second + t * t * t;
+    };
+
+    auto low = 0.f;
+    auto high = 1.f;
+
+    for (auto i = 0; i < 24; i += 1)
+    {
+        auto const middle = (low + high) / 2.f;
+        if (bezier(middle, curve.minX, curve.maxX) < pressure) low = middle;
+        else high = middle;
+    }
+
+    return std::clamp(bezier((low + high) / 2.f, curve.minY, curve.maxY), 0.f, 1.f);
+}
+
+StylusMapping make_stylus_mapping(Region const& area, Region const& output, Pressure const& curve, AxisInfo const& pressure)
+{
+    StylusMapping mapping { area, output, {} };
+
+    auto const levels = std::clamp(pressure.maximum - pressure.minimum + 1, 2, MAX_PRESSURE_LEVELS);
+    mapping.pressureTable.resize(static_cast<size_t>(levels));
+
+    for (auto i = 0zu; i < mapping.pressureTable.size(); i += 1)
+    {
+        mapping.pressureTable[i] = evaluate_pressure_curve(curve, static_cast<float>(i) / static_cast<float>(levels - 1));
+    }
+
+    return mapping;
+}
+
+// the area is the driver's, so its width and height are really the far corner
+MappedSample map_stylus_sample(StylusMapping const& mapping, StylusSample const& sample)
+{
+    auto const& [area, output, pressureTable] = mapping;
+
+    auto const x = std::clamp(static_cast<float>(sample.x - area.offsetX) / static_cast<float>(std::max(1, area.width - area.offsetX)), 0.f, 1.f);
+    auto const y = std::clamp(static_cast<float>(sample.y - area.offsetY) / static_cast<float>(std::max(1, area.height - area.offsetY)), 0.f, 1.f);
+    auto const level = std::clamp(sample.pressure, 0, static_cast<int>(pressureTable.size()) - 1);
+
+    return {
+        sample.time,
+        static_cast<float>(output.offsetX) + x * static_cast<float>(output.width),
+        static_cast<float>(output.offsetY) + y * static_cast<float>(output.height),
+        pressureTable[static_cast<size_t>(level)],
+        sample.contact
+    };
+}
+
+// an axis at a time through the batch kernels, the area onto [0, 1] where it's clamped, then onto the output
+static void map_stylus_axis(std::span<float> values, int areaMin, int areaMax, int outputMin, int outputSize)
+{
+    normalize<float>(values, values, static_cast<float>(areaMin), static_cast<float>(areaMin + std::max(1, areaMax - areaMin)));
+    for (auto& value : values) value = std::clamp(value, 0.f, 1.f);
+    lmap<float>(values, values, 0.f, 1.f, static_cast<float>(outputMin), static_cast<float>(outputMin + outputSize));
+}
+
+void map_stylus_samples(StylusMapping const& mapping, std::span<StylusSample const> samples, std::span<MappedSample> samplesOut)
+{
+    assert(samples.size() == samplesOut.size() && "SPANS MUST HAVE THE SAME SIZE");
+
+    auto const& [area, output, pressureTable] = mapping;
+
+    std::vector<float> xs(samples.size());
+    std::vector<float> ys(samples.size());
+    std::ranges::transform(samples, xs.begin(), [] (auto&& sample) { return static_cast<float>(sample.x); });
+    std::ranges::transform(samples, ys.begin(), [] (auto&& sample) { return static_cast<float>(sample.y); });
+
+    map_stylus_axis(xs, area.offsetX, area.width, output.offsetX, output.width);
+    map_stylus_axis(ys, area.offsetY, area.height, output.offsetY, output.height);
+
+    for (auto i = 0zu; i < samples.size(); i += 1)
+    {
+        auto const level = std::clamp(samples[i].pressure, 0, static_cast<int>(pressureTable.size()) - 1);
+        samplesOut[i] = { samples[i].time, xs[i], ys[i], pressureTable[static_cast<size_t>(level)], samples[i].contact };
+    }
+}
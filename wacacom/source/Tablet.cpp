@@ -1,4 +1,9 @@
 #include "Tablet.hpp"
+#include "Display.hpp"
+#include "Properties.hpp"
+#include "TabletModels.hpp"
+#include "Transform.hpp"
+#include "XInput.hpp"
 
 static std::string trim(auto value) requires std::is_convertible_v<decltype(value), std::string>
 {
@@ -28,7 +33,7 @@ std::vector<Device> get_devices()
             auto const name = trim(match.get<1>().to_string());
             auto const id = match.get<2>().to_number();
             auto const type = DeviceType::from_string(trim(match.get<3>().to_string()));
-            devices.push_back({ name, id, type });
+            devices.push_back({ name, id, type, {}, {} });
         }
     }
 
@@ -44,121 +49,63 @@ std::vector<Device> get_drawing_devices()
 
 Region get_device_area(Device const& device)
 {
-    Region area {};
-
-    auto const command = fmt::format("xsetwacom --get {} Area", device.id);
-    auto const fd = popen(command.data(), "r");
-    assert(fd && "FILE DESCRIPTOR WAS NULL");
-
-    std::array<char, 512> buffer {};
-    fgets(buffer.data(), buffer.size(), fd);
-    std::stringstream sstream(buffer.data());
-    sstream >> area.offsetX;
-    sstream >> area.offsetY;
-    sstream >> area.width;
-    sstream >> area.height;
-
-    pclose(fd);
-
-    return area;
+    auto const set = read_device_properties(device.id, std::array { AREA_PROPERTY });
+    auto const [x1, y1, x2, y2] = get_property<AREA_PROPERTY>(set).value_or(PropertyValue<AREA_PROPERTY> {});
+    return { x1, y1, x2, y2 };
 }
 
 Region get_device_entire_area(Device const& device)
 {
-    Region area {};
+    // known models don't need the driver to be reset just to learn their sensor size
+    if (auto const model = find_tablet_model(device.identity.vendor, device.identity.product)) return get_tablet_model_area(*model);
 
     auto const currentArea = get_device_area(device);
     reset_device_area(device);
-
-    auto const command = fmt::format("xsetwacom --get {} Area", device.id);
-    auto const fd = popen(command.data(), "r");
-    assert(fd && "FILE DESCRIPTOR WAS NULL");
-
-    std::array<char, 512> buffer {};
-    fgets(buffer.data(), buffer.size(), fd);
-    std::stringstream sstream(buffer.data());
-    sstream >> area.offsetX;
-    sstream >> area.offsetY;
-    sstream >> area.width;
-    sstream >> area.height;
-
-    pclose(fd);
-
+    auto const area = get_device_area(device);
     set_device_area(device, currentArea);
 
     return area;
 }
 
-void set_device_output_from_display_name(Device const& device, std::string_view displayName)
+// a single write of the transformation matrix, rotation and all, instead of having xsetwacom look the output up again
+void set_device_output_from_display_region(Device const& device, Region const& dimension, Rotation rotation)
 {
-    auto const command = fmt::format("xsetwacom --set \"{}\" MapToOutput {}", device.id, displayName);
-    auto const fd = popen(command.data(), "r");
-    assert(fd && "FILE DESCRIPTOR WAS NULL");
-    pclose(fd);
-}
-
-void set_device_output_from_display_region(Device const& device, Region const& dimension)
-{
-    auto const command = fmt::format("xsetwacom --set \"{}\" MapToOutput {}x{}+0+0", device.id, dimension.width, dimension.height, dimension.offsetX, dimension.offsetY);
-    auto const fd = popen(command.data(), "r");
-    assert(fd && "FILE DESCRIPTOR WAS NULL");
-    pclose(fd);
+    auto const matrix = get_output_transform(dimension, query_screen_region(), rotation);
+    write_device_properties(std::array { make_float_write(device.id, TRANSFORM_PROPERTY.property, matrix) });
 }
 
 void set_device_area(Device const& device, Region const& area)
 {
-    auto const command = fmt::format("xsetwacom --set {} Area {} {} {} {}", device.id, area.offsetX, area.offsetY, area.width, area.height);
-    auto const fd = popen(command.data(), "r");
-    assert(fd && "FILE DESCRIPTOR WAS NULL");
-    pclose(fd);
+    PropertySet set { device.id, {} };
+    set_property<AREA_PROPERTY>(set, { area.offsetX, area.offsetY, area.width, area.height });
+    write_property_set(set);
 }
 
+// the driver takes an area of all -1 as going back to the whole tablet
 void reset_device_area(Device const& device)
 {
-    auto const command = fmt::format("xsetwacom --set {} ResetArea", device.id);
-    auto const fd = popen(command.data(), "r");
-    assert(fd && "FILE DESCRIPTOR WAS NULL");
-    pclose(fd);
+    PropertySet set { device.id, {} };
+    set_property<AREA_PROPERTY>(set, { -1, -1, -1, -1 });
+    write_property_set(set);
 }
 
+// the driver keeps the curve's control points in hundredths
 Pressure get_device_pressure_curve(Device const& device)
 {
-    Pressure pressure {};
-
-    auto const command = fmt::format("xsetwacom --get {} PressureCurve", device.id);
-    auto const fd = popen(command.data(), "r");
-    assert(fd && "FILE DESCRIPTOR WAS NULL");
-
-    std::array<char, 512> buffer {};
-    fgets(buffer.data(), buffer.size(), fd);
-    std::stringstream sstream(buffer.data());
-
-    sstream >> pressure.minX;
-    pressure.minX /= 100.f;
+    auto const set = read_device_properties(device.id, std::array { PRESSURE_CURVE_PROPERTY });
+    auto const [minX, minY, maxX, maxY] = get_property<PRESSURE_CURVE_PROPERTY>(set).value_or(PropertyValue<PRESSURE_CURVE_PROPERTY> { 0, 0, 100, 100 });
 
-    sstream >> pressure.minY;
-    pressure.minY /= 100.f;
-
-    sstream >> pressure.maxX;
-    pressure.maxX /= 100.f;
-
-    sstream >> pressure.maxY;
-    pressure.maxY /= 100.f;
-
-    pclose(fd);
-
-    return pressure;
+    return {
+        static_cast<float>(minX) / 100.f, static_cast<float>(minY) / 100.f,
+        static_cast<float>(maxX) / 100.f, static_cast<float>(maxY) / 100.f
+    };
 }
 
 void set_device_pressure_curve(Device const& device, Pressure const& pressure)
 {
-    auto const minX = std::round(pressure.minX * 100.f);
-    auto const minY = std::round(pressure.minY * 100.f);
-    auto const maxX = std::round(pressure.maxX * 100.f);
-    auto const maxY = std::round(pressure.maxY * 100.f);
-    auto const command = fmt::format("xsetwacom --set {} PressureCurve {} {} {} {}", device.id, minX, minY, maxX, maxY);
-    auto const fd = popen(command.data(), "r");
-    assert(fd && "FILE DESCRIPTOR WAS NULL");
-    pclose(fd);
-}
+    auto const toHundredths = [] (float value) { return static_cast<int>(std::lround(value * 100.f)); };
 
+    PropertySet set { device.id, {} };
+    set_property<PRESSURE_CURVE_PROPERTY>(set, { toHundredths(pressure.minX), toHundredths(pressure.minY), toHundredths(pressure.maxX), toHundredths(pressure.maxY) });
+    write_property_set(set);
+}
@@ -0,0 +1,46 @@
+#include "Texture.hpp"
+
+#include <GL/gl.h>
+
+#include <cassert>
+
+static std::uint64_t textureGeneration = 0;
+
+Texture create_texture(int width, int height)
+{
+    Texture texture { 0, width, height };
+
+    glGenTextures(1, &texture.id);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    return texture;
+}
+
+void destroy_texture(Texture& texture)
+{
+    if (texture.id != 0) glDeleteTextures(1, &texture.id);
+    texture.id = 0;
+}
+
+void update_texture(Texture const& texture, Region const& region, std::span<std::uint32_t const> pixels)
+{
+    assert(pixels.size() == static_cast<size_t>(texture.width * texture.height) && "PIXELS MUST COVER THE WHOLE TEXTURE");
+
+    auto const* first = pixels.data() + region.offsetY * texture.width + region.offsetX;
+
+    // the rows of the region are strided by the width of the whole image
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, texture.width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, region.offsetX, region.offsetY, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE, first);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    textureGeneration += 1;
+}
+
+std::uint64_t get_texture_generation()
+{
+    return textureGeneration;
+}
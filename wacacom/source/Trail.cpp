@@ -0,0 +1,153 @@
+#include "Trail.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// closer together than this (relative to the tablet) is the same spot as far as a preview can tell
+static auto constexpr MIN_TRAIL_DISTANCE = 1.f / 800.f;
+// reports are a few milliseconds apart, a longer gap means the pen left proximity in between
+static auto constexpr TRAIL_GAP = std::int64_t { 100'000 };
+
+PenTrail make_pen_trail(AxisInfo const& x, AxisInfo const& y)
+{
+    return { x, y, {}, 0, 0 };
+}
+
+static TrailPoint const& get_trail_point(PenTrail const& trail, std::size_t index)
+{
+    return trail.points[(trail.head + TRAIL_CAPACITY - trail.size + index) % TRAIL_CAPACITY];
+}
+
+// samples that barely move are dropped as they come in, so a pen resting on the tablet doesn't flush the
+// buffer, whatever the report rate is
+void add_trail_samples(PenTrail& trail, std::span<StylusSample const> samples)
+{
+    auto const minimum = MIN_TRAIL_DISTANCE * static_cast<float>(std::max(trail.x.maximum - trail.x.minimum, trail.y.maximum - trail.y.minimum));
+
+    for (auto const& sample : samples)
+    {
+        Point const position { static_cast<float>(sample.x), static_cast<float>(sample.y) };
+
+        auto connected = false;
+
+        if (trail.size > 0)
+        {
+            auto const& last = get_trail_point(trail, trail.size - 1);
+            connected = last.contact == sample.contact && sample.time - last.time < TRAIL_GAP;
+
+            auto const distance = std::hypot(position.x - last.position.x, position.y - last.position.y);
+            if (connected && distance < minimum) continue;
+        }
+
+        trail.points[trail.head] = { sample.time, position, sample.contact, connected };
+        trail.head = (trail.head + 1) % TRAIL_CAPACITY;
+        trail.size = std::min(trail.size + 1, TRAIL_CAPACITY);
+    }
+}
+
+static float get_segment_distance(Point const& point, Point const& start, Point const& end)
+{
+    auto const dx = end.x - start.x;
+    auto const dy = end.y - start.y;
+    auto const length = dx * dx + dy * dy;
+
+    if (length == 0.f) return std::hypot(point.x - start.x, point.y - start.y);
+
+    auto const t = std::clamp(((point.x - start.x) * dx + (point.y - start.y) * dy) / length, 0.f, 1.f);
+    return std::hypot(point.x - (start.x + t * dx), point.y - (start.y + t * dy));
+}
+
+// Ramer-Douglas-Peucker, with an explicit stack since strokes can be long
+static std::vector<Point> simplify_stroke(std::span<Point const> points, float epsilon)
+{
+    if (points.size() < 3) return { points.begin(), points.end() };
+
+    std::vector<bool> keep(points.size(), false);
+    keep.front() = keep.back() = true;
+
+    std::vector<std::pair<std::size_t, std::size_t>> ranges { { 0, points.size() - 1 } };
+
+    while (!ranges.empty())
+    {
+        auto const [first, last] = ranges.back();
+        ranges.pop_back();
+
+        auto farthest = first;
+        auto distance = 0.f;
+
+        for (auto i = first + 1; i < last; i += 1)
+        {
+            auto const current = get_segment_distance(points[i], points[first], points[last]);
+            if (current <= distance) continue;
+            farthest = i;
+            distance = current;
+        }
+
+        if (distance <= epsilon) continue;
+
+        keep[farthest] = true;
+        ranges.push_back({ first, farthest });
+        ranges.push_back({ farthest, last });
+    }
+
+    std::vector<Point> simplified {};
+    for (auto i = 0zu; i < points.size(); i += 1)
+    {
+        if (keep[i]) simplified.push_back(points[i]);
+    }
+
+    return simplified;
+}
+
+std::vector<TrailStroke> get_trail_strokes(PenTrail const& trail, std::int64_t since)
+{
+    std::vector<TrailStroke> strokes {};
+    auto total = 0zu;
+
+    for (auto i = 0zu; i < trail.size; i += 1)
+    {
+        auto const& point = get_trail_point(trail, i);
+        if (point.time < since) continue;
+
+        if (strokes.empty() || !point.connected) strokes.push_back({ point.contact, {} });
+        strokes.back().points.push_back(point.position);
+        total += 1;
+    }
+
+    // simplifying never gets a stroke below its two ends, so when those alone don't fit, the oldest strokes go.
+    // a burst of single taps or proximity flickers would otherwise never fit
+    auto const getEnds = [] (TrailStroke const& stroke) { return std::min(stroke.points.size(), 2zu); };
+    auto ends = std::accumulate(strokes.begin(), strokes.end(), 0zu, [&] (auto sum, auto const& stroke) { return sum + getEnds(stroke); });
+    auto dropped = 0zu;
+
+    while (ends > MAX_TRAIL_VERTICES)
+    {
+        ends -= getEnds(strokes[dropped]);
+        total -= strokes[dropped].points.size();
+        dropped += 1;
+    }
+
+    strokes.erase(strokes.begin(), strokes.begin() + static_cast<std::ptrdiff_t>(dropped));
+
+    // the tolerance starts below what's visible in the mapper and doubles until the count fits, so a slow
+    // stroke is drawn as is and a fast scribble costs the same as a slow one. with the ends fitting, it's done
+    // at the latest once it's past the longest distance on the tablet
+    auto epsilon = MIN_TRAIL_DISTANCE * static_cast<float>(std::max(trail.x.maximum - trail.x.minimum, trail.y.maximum - trail.y.minimum));
+    auto simplified = strokes;
+
+    while (total > MAX_TRAIL_VERTICES)
+    {
+        total = 0;
+
+        for (auto i = 0zu; i < strokes.size(); i += 1)
+        {
+            simplified[i].points = simplify_stroke(strokes[i].points, epsilon);
+            total += simplified[i].points.size();
+        }
+
+        epsilon *= 2.f;
+    }
+
+    return simplified;
+}
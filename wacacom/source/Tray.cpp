@@ -0,0 +1,83 @@
+#include "Tray.hpp"
+
+#include <poll.h>
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <csignal>
+#include <ranges>
+#include <vector>
+
+#include "X11.hpp"
+
+TrayWatcher open_tray_watcher(std::string_view hotkey)
+{
+    sigset_t mask {};
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    TrayWatcher watcher { XOpenDisplay(nullptr), std::nullopt, signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC) };
+    assert(watcher.display && "COULD NOT OPEN X DISPLAY");
+    assert(watcher.signals != -1 && "COULD NOT CREATE SIGNALFD");
+
+    watcher.hotkey = parse_hotkey(watcher.display, hotkey);
+    if (watcher.hotkey) grab_hotkey(watcher.display, *watcher.hotkey);
+    XFlush(watcher.display);
+
+    return watcher;
+}
+
+void close_tray_watcher(TrayWatcher& watcher)
+{
+    if (watcher.hotkey) ungrab_hotkey(watcher.display, *watcher.hotkey);
+    XCloseDisplay(watcher.display);
+    close(watcher.signals);
+
+    watcher.display = nullptr;
+    watcher.signals = -1;
+}
+
+bool take_show_request(TrayWatcher& watcher)
+{
+    auto requested = false;
+
+    for (signalfd_siginfo info {}; read(watcher.signals, &info, sizeof(info)) == sizeof(info);) requested = true;
+
+    while (XPending(watcher.display))
+    {
+        XEvent event {};
+        XNextEvent(watcher.display, &event);
+
+        if (event.type == KeyPress && watcher.hotkey && is_hotkey_event(*watcher.hotkey, static_cast<int>(event.xkey.keycode), event.xkey.state))
+        {
+            requested = true;
+        }
+    }
+
+    return requested;
+}
+
+// sleeps in poll, a hidden window costs no cpu at all
+bool wait_for_show_request(TrayWatcher& watcher, std::span<int const> wake, int timeout)
+{
+    while (!take_show_request(watcher))
+    {
+        std::vector<pollfd> fds { { watcher.signals, POLLIN, 0 }, { ConnectionNumber(watcher.display), POLLIN, 0 } };
+        for (auto const fd : wake) fds.push_back({ fd, POLLIN, 0 });
+
+        auto const ready = poll(fds.data(), fds.size(), timeout);
+        if (ready == 0) return false;
+        // the window comes back rather than the caller spinning on an error that polling again won't clear
+        if (ready == -1 && errno != EINTR) return true;
+
+        auto const woken = std::ranges::any_of(fds | std::views::drop(2), [] (auto&& fd) { return (fd.revents & POLLIN) != 0; });
+        if (woken) return take_show_request(watcher);
+    }
+
+    return true;
+}
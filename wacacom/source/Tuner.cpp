@@ -0,0 +1,204 @@
+#include "Tuner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+// how long the driver needs to flush the reports it was averaging with the previous setting
+static auto constexpr TUNER_SETTLE_TIME = std::int64_t { 50'000 };
+// how much of the right kind of motion a candidate is measured on
+static auto constexpr TUNER_WINDOW = std::int64_t { 300'000 };
+static auto constexpr TUNER_MIN_MOTIONS = 10zu;
+static auto constexpr MAX_LAG_MS = 80;
+
+static std::int64_t get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// a single batched write, and the measurement starts as soon as the server has it
+static void write_candidate(Tuner& tuner)
+{
+    auto const& [rawSample, suppress] = tuner.results.at(tuner.current).candidate;
+
+    set_property<RAW_SAMPLE_PROPERTY>(tuner.settings, { rawSample });
+    set_property<SUPPRESS_PROPERTY>(tuner.settings, { suppress });
+    write_property_set(tuner.settings);
+
+    tuner.settled = get_time() + TUNER_SETTLE_TIME;
+    tuner.samples.clear();
+    tuner.motions.clear();
+}
+
+Tuner start_tuner(Device const& device, AxisInfo const& axis)
+{
+    auto const original = read_device_properties(device.id, std::array { RAW_SAMPLE_PROPERTY, SUPPRESS_PROPERTY });
+
+    Tuner tuner { TunerPhase::IDLE, axis, original, original, {}, {}, 0, 0, {}, {}, std::nullopt };
+
+    // without the property there's nothing to tune
+    if (!get_property<RAW_SAMPLE_PROPERTY>(original)) return tuner;
+
+    for (auto const& candidate : TUNER_CANDIDATES) tuner.results.push_back({ candidate, 0.0, 0.0, false });
+
+    tuner.watcher = open_motion_watcher(device.id);
+    tuner.phase = TunerPhase::HOVER;
+    write_candidate(tuner);
+
+    return tuner;
+}
+
+// what the driver does on its own, step to step, while the hand holds still. suppress zeroes the small
+// steps out, raw sample averages them down.
+static double measure_jitter(std::span<RawMotion const> motions)
+{
+    if (motions.size() < 2) return 0.0;
+
+    auto sum = 0.0;
+    for (auto i = 1zu; i < motions.size(); i += 1)
+    {
+        auto const dx = motions[i].x - motions[i - 1].x;
+        auto const dy = motions[i].y - motions[i - 1].y;
+        sum += dx * dx + dy * dy;
+    }
+
+    return std::sqrt(sum / static_cast<double>(motions.size() - 1));
+}
+
+// the shift, in whole milliseconds, that lines what the driver posted up best with where the pen was
+static double measure_lag(std::span<StylusSample const> samples, std::span<RawMotion const> motions)
+{
+    auto best = 0;
+    auto bestError = std::numeric_limits<double>::max();
+
+    for (auto shift = 0; shift <= MAX_LAG_MS; shift += 1)
+    {
+        auto error = 0.0;
+        auto count = 0;
+
+        for (auto const& motion : motions)
+        {
+            auto const time = motion.time - shift * 1'000;
+            auto const after = std::ranges::lower_bound(samples, time, {}, &StylusSample::time);
+            if (after == samples.begin() || after == samples.end()) continue;
+
+            auto const& before = *std::prev(after);
+            auto const t = static_cast<double>(time - before.time) / static_cast<double>(std::max(after->time - before.time, std::int64_t { 1 }));
+            auto const dx = motion.x - (before.x + (after->x - before.x) * t);
+            auto const dy = motion.y - (before.y + (after->y - before.y) * t);
+
+            error += dx * dx + dy * dy;
+            count += 1;
+        }
+
+        if (count == 0 || error / count >= bestError) continue;
+
+        best = shift;
+        bestError = error / count;
+    }
+
+    return static_cast<double>(best);
+}
+
+// the knee of the pareto front, each measure relative to the worst one seen
+static void rank_results(Tuner& tuner)
+{
+    auto& results = tuner.results;
+
+    for (auto& result : results)
+    {
+        result.pareto = std::ranges::none_of(results, [&] (auto&& other) {
+            return other.jitter <= result.jitter && other.lag <= result.lag && (other.jitter < result.jitter || other.lag < result.lag);
+        });
+    }
+
+    auto const maxJitter = std::max(std::ranges::max(results, {}, &TunerResult::jitter).jitter, std::numeric_limits<double>::epsilon());
+    auto const maxLag = std::max(std::ranges::max(results, {}, &TunerResult::lag).lag, std::numeric_limits<double>::epsilon());
+
+    auto bestScore = std::numeric_limits<double>::max();
+    for (auto i = 0zu; i < results.size(); i += 1)
+    {
+        auto const score = results[i].jitter / maxJitter + results[i].lag / maxLag;
+        if (!results[i].pareto || score >= bestScore) continue;
+
+        tuner.recommended = i;
+        bestScore = score;
+    }
+}
+
+void update_tuner(Tuner& tuner, std::span<StylusSample const> samples)
+{
+    if (tuner.phase != TunerPhase::HOVER && tuner.phase != TunerPhase::STROKES) return;
+
+    auto const hovering = tuner.phase == TunerPhase::HOVER;
+
+    // the window starts over whenever the pen does the wrong thing, touching down while it should hover or
+    // lifting while it should draw
+    for (auto const& sample : samples)
+    {
+        if (sample.time < tuner.settled) continue;
+
+        if (sample.contact == hovering)
+        {
+            tuner.samples.clear();
+            tuner.motions.clear();
+            continue;
+        }
+
+        tuner.samples.push_back(sample);
+    }
+
+    for (auto const& motion : poll_raw_motion(tuner.watcher))
+    {
+        if (!tuner.samples.empty() && motion.time >= tuner.samples.front().time) tuner.motions.push_back(motion);
+    }
+
+    if (tuner.samples.size() < 2 || tuner.samples.back().time - tuner.samples.front().time < TUNER_WINDOW) return;
+
+    auto& result = tuner.results.at(tuner.current);
+    auto const unitsPerMm = tuner.axis.resolution > 0 ? static_cast<double>(tuner.axis.resolution) : 1.0;
+
+    // with enough suppression the driver may post nothing at all while hovering, which is no jitter
+    if (hovering)
+    {
+        result.jitter = measure_jitter(tuner.motions) / unitsPerMm;
+    }
+    else
+    {
+        if (tuner.motions.size() < TUNER_MIN_MOTIONS) return;
+        result.lag = measure_lag(tuner.samples, tuner.motions);
+    }
+
+    tuner.current += 1;
+
+    if (tuner.current == tuner.results.size())
+    {
+        tuner.current = 0;
+        tuner.phase = hovering ? TunerPhase::STROKES : TunerPhase::DONE;
+    }
+
+    if (tuner.phase == TunerPhase::DONE)
+    {
+        rank_results(tuner);
+        stop_tuner(tuner);
+        tuner.phase = TunerPhase::DONE;
+        return;
+    }
+
+    write_candidate(tuner);
+}
+
+void stop_tuner(Tuner& tuner)
+{
+    if (tuner.phase == TunerPhase::IDLE) return;
+
+    if (tuner.watcher.display != nullptr)
+    {
+        for (auto& entry : tuner.original.entries) entry.dirty = true;
+        write_property_set(tuner.original);
+        close_motion_watcher(tuner.watcher);
+    }
+
+    tuner.phase = TunerPhase::IDLE;
+}
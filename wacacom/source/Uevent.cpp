@@ -0,0 +1,72 @@
+#include "Uevent.hpp"
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+
+#include <array>
+#include <cassert>
+#include <string_view>
+
+static auto constexpr KERNEL_UEVENT_GROUP = 1u;
+
+int open_uevent_socket()
+{
+    auto const fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    assert(fd != -1 && "COULD NOT OPEN UEVENT SOCKET");
+
+    sockaddr_nl address {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = KERNEL_UEVENT_GROUP;
+
+    [[maybe_unused]] auto const bound = bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    assert(bound == 0 && "COULD NOT BIND UEVENT SOCKET");
+
+    return fd;
+}
+
+std::optional<Uevent> parse_uevent(std::span<char const> message)
+{
+    Uevent uevent {};
+
+    // "ACTION@DEVPATH" followed by NUL separated KEY=VALUE pairs
+    std::string_view const data(message.data(), message.size());
+    auto const header = data.substr(0, data.find('\0'));
+    if (header.find('@') == std::string_view::npos) return std::nullopt;
+
+    for (auto position = header.size() + 1; position < data.size();)
+    {
+        auto end = data.find('\0', position);
+        if (end == std::string_view::npos) end = data.size();
+
+        auto const entry = data.substr(position, end - position);
+        if (auto const separator = entry.find('='); separator != std::string_view::npos)
+        {
+            uevent.properties.emplace(entry.substr(0, separator), entry.substr(separator + 1));
+        }
+
+        position = end + 1;
+    }
+
+    if (!uevent.properties.contains("ACTION") || !uevent.properties.contains("DEVPATH")) return std::nullopt;
+
+    uevent.action = uevent.properties.at("ACTION");
+    uevent.devpath = uevent.properties.at("DEVPATH");
+    if (uevent.properties.contains("SUBSYSTEM")) uevent.subsystem = uevent.properties.at("SUBSYSTEM");
+
+    return uevent;
+}
+
+std::optional<Uevent> receive_uevent(int socket)
+{
+    std::array<char, 8192> buffer {};
+    sockaddr_nl sender {};
+    socklen_t senderSize = sizeof(sender);
+
+    auto const size = recvfrom(socket, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&sender), &senderSize);
+    if (size <= 0) return std::nullopt;
+
+    // anything not coming from the kernel itself is spoofable, so it's dropped
+    if (sender.nl_pid != 0) return std::nullopt;
+
+    return parse_uevent({ buffer.data(), static_cast<size_t>(size) });
+}
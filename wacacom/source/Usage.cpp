@@ -0,0 +1,110 @@
+#include "Usage.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// below this there isn't enough to go on, a few strokes would decide the whole area
+static auto constexpr MIN_USAGE_SAMPLES = 1000u;
+
+UsageSketch make_usage_sketch(AxisInfo const& x, AxisInfo const& y)
+{
+    return { x, y, {}, {}, 0 };
+}
+
+static size_t get_usage_bin(AxisInfo const& axis, int value)
+{
+    auto const range = std::max(1, axis.maximum - axis.minimum);
+    auto const bin = static_cast<long long>(value - axis.minimum) * static_cast<long long>(USAGE_SKETCH_BINS) / range;
+    return static_cast<size_t>(std::clamp(bin, 0ll, static_cast<long long>(USAGE_SKETCH_BINS - 1)));
+}
+
+void add_usage_samples(UsageSketch& sketch, std::span<StylusSample const> samples)
+{
+    for (auto const& sample : samples)
+    {
+        if (!sample.contact) continue;
+
+        sketch.xBins[get_usage_bin(sketch.x, sample.x)] += 1;
+        sketch.yBins[get_usage_bin(sketch.y, sample.y)] += 1;
+        sketch.count += 1;
+    }
+}
+
+// the position below which `quantile` of the samples fall, interpolated within its bin
+static float get_usage_quantile(std::span<std::uint64_t const> bins, std::uint64_t count, AxisInfo const& axis, float quantile)
+{
+    auto const target = static_cast<double>(quantile) * static_cast<double>(count);
+    auto const binSize = static_cast<double>(axis.maximum - axis.minimum) / static_cast<double>(bins.size());
+
+    auto cumulative = 0.0;
+
+    for (auto i = 0zu; i < bins.size(); i += 1)
+    {
+        auto const next = cumulative + static_cast<double>(bins[i]);
+
+        if (next >= target && bins[i] > 0)
+        {
+            auto const fraction = (target - cumulative) / static_cast<double>(bins[i]);
+            return static_cast<float>(axis.minimum + (static_cast<double>(i) + fraction) * binSize);
+        }
+
+        cumulative = next;
+    }
+
+    return static_cast<float>(axis.maximum);
+}
+
+// the same amount is trimmed off each side of each axis, so strays at the edges (resting the pen on the
+// bezel, a slip) don't stretch the area. the box is then grown along one axis to the aspect ratio of the
+// output, centered on what was used and pushed back inside the tablet if it sticks out.
+//
+// the sketch only knows each axis on its own, so which samples two trims cut off can't be told apart. at worst
+// none are the same and the four trims add up, which is why each one only gets a quarter of what may be left
+// out. the box then holds at least `coverage` of the samples.
+std::optional<Region> recommend_tablet_area(UsageSketch const& sketch, float coverage, int aspectWidth, int aspectHeight)
+{
+    if (sketch.count < MIN_USAGE_SAMPLES || aspectWidth <= 0 || aspectHeight <= 0) return std::nullopt;
+
+    auto const tail = (1.f - std::clamp(coverage, 0.5f, 1.f)) / 4.f;
+
+    auto left = get_usage_quantile(sketch.xBins, sketch.count, sketch.x, tail);
+    auto right = get_usage_quantile(sketch.xBins, sketch.count, sketch.x, 1.f - tail);
+    auto top = get_usage_quantile(sketch.yBins, sketch.count, sketch.y, tail);
+    auto bottom = get_usage_quantile(sketch.yBins, sketch.count, sketch.y, 1.f - tail);
+
+    auto const aspect = static_cast<float>(aspectWidth) / static_cast<float>(aspectHeight);
+    auto width = std::max(1.f, right - left);
+    auto height = std::max(1.f, bottom - top);
+
+    if (width / height < aspect) width = height * aspect;
+    else height = width / aspect;
+
+    auto const tabletWidth = static_cast<float>(sketch.x.maximum - sketch.x.minimum);
+    auto const tabletHeight = static_cast<float>(sketch.y.maximum - sketch.y.minimum);
+
+    // too big to fit, the largest area with that aspect ratio is the best there is. scaling can come out a
+    // rounding step over, which is cut off
+    if (width > tabletWidth || height > tabletHeight)
+    {
+        auto const scale = std::min(tabletWidth / width, tabletHeight / height);
+        width = std::min(width * scale, tabletWidth);
+        height = std::min(height * scale, tabletHeight);
+    }
+
+    auto const centerX = (left + right) / 2.f;
+    auto const centerY = (top + bottom) / 2.f;
+
+    // an area as wide as the tablet has exactly one place to go, the upper bound can't be let below the lower
+    auto const minX = static_cast<float>(sketch.x.minimum);
+    auto const minY = static_cast<float>(sketch.y.minimum);
+    left = std::clamp(centerX - width / 2.f, minX, std::max(minX, static_cast<float>(sketch.x.maximum) - width));
+    top = std::clamp(centerY - height / 2.f, minY, std::max(minY, static_cast<float>(sketch.y.maximum) - height));
+
+    // the driver's area takes the far corner where the width and height are
+    return Region {
+        static_cast<int>(std::lround(left)),
+        static_cast<int>(std::lround(top)),
+        static_cast<int>(std::lround(left + width)),
+        static_cast<int>(std::lround(top + height))
+    };
+}
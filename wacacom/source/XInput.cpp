@@ -0,0 +1,448 @@
+#include "XInput.hpp"
+#include "Properties.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <time.h>
+
+#include "X11.hpp"
+
+static auto constexpr NODE_PROPERTY = "Device Node";
+static auto constexpr PRODUCT_PROPERTY = "Device Product ID";
+
+// Xlib connections aren't safe to share between threads, so every thread gets its own
+static XDisplay* get_connection()
+{
+    thread_local std::unique_ptr<XDisplay, decltype(&XCloseDisplay)> const display(XOpenDisplay(nullptr), &XCloseDisplay);
+    assert(display && "COULD NOT OPEN X DISPLAY");
+    return display.get();
+}
+
+// a device can be unplugged between being listed and being touched, and Xlib's default handler exits on the
+// BadDevice that follows. requests naming a device go out under a trap instead, which syncs them and tells
+// whether any of them failed. the handler is the whole process's, so traps on different threads take turns
+static std::mutex errorTrapMutex {};
+static thread_local bool trappedError = false;
+
+static int trap_x_error(XDisplay*, XErrorEvent*)
+{
+    trappedError = true;
+    return 0;
+}
+
+template <class F>
+static bool trap_x_errors(XDisplay* display, F&& requests)
+{
+    std::scoped_lock const lock(errorTrapMutex);
+
+    // whatever was already in flight isn't the trap's business
+    XSync(display, False);
+    trappedError = false;
+
+    auto const previous = XSetErrorHandler(trap_x_error);
+    requests();
+    XSync(display, False);
+    XSetErrorHandler(previous);
+
+    return !trappedError;
+}
+
+template <size_t LENGTH>
+static std::optional<std::array<long, LENGTH>> get_integer_property(XDisplay* display, int deviceId, Atom property)
+{
+    Atom type {};
+    int format {};
+    unsigned long count {};
+    unsigned long remaining {};
+    unsigned char* data {};
+
+    auto status = Success;
+    auto const trapped = trap_x_errors(display, [&] {
+        status = XIGetProperty(display, deviceId, property, 0, LENGTH, False, XA_INTEGER, &type, &format, &count, &remaining, &data);
+    });
+    if (!trapped || status != Success) return std::nullopt;
+
+    std::optional<std::array<long, LENGTH>> values {};
+
+    // format 32 properties come back as an array of long, whatever the size of long is
+    if (type == XA_INTEGER && format == 32 && count == LENGTH)
+    {
+        values.emplace();
+        std::copy_n(reinterpret_cast<long const*>(data), LENGTH, values->begin());
+    }
+
+    XFree(data);
+
+    return values;
+}
+
+static std::string get_string_property(XDisplay* display, int deviceId, Atom property)
+{
+    Atom type {};
+    int format {};
+    unsigned long count {};
+    unsigned long remaining {};
+    unsigned char* data {};
+
+    auto status = Success;
+    auto const trapped = trap_x_errors(display, [&] {
+        status = XIGetProperty(display, deviceId, property, 0, 256, False, XA_STRING, &type, &format, &count, &remaining, &data);
+    });
+    if (!trapped || status != Success) return {};
+
+    std::string value {};
+    if (type == XA_STRING && format == 8) value.assign(reinterpret_cast<char const*>(data), count);
+
+    XFree(data);
+
+    return value;
+}
+
+std::vector<Device> list_xinput_devices()
+{
+    std::vector<Device> devices {};
+
+    auto* display = get_connection();
+    auto const nodeAtom = XInternAtom(display, NODE_PROPERTY, False);
+    auto const productAtom = XInternAtom(display, PRODUCT_PROPERTY, False);
+
+    auto count = 0;
+    auto* infos = XListInputDevices(display, &count);
+
+    for (auto const& info : std::span(infos, static_cast<size_t>(count)))
+    {
+        if (info.type == None) continue;
+
+        auto* typeName = XGetAtomName(display, info.type);
+        std::string const type(typeName);
+        XFree(typeName);
+
+        if (type != "STYLUS" && type != "PAD" && type != "ERASER" && type != "TOUCH") continue;
+
+        auto const id = static_cast<int>(info.id);
+        Device device { info.name, id, DeviceType::from_string(type), {}, get_string_property(display, id, nodeAtom) };
+
+        if (auto const product = get_integer_property<2>(display, id, productAtom))
+        {
+            device.identity.vendor = static_cast<int>(product->at(0));
+            device.identity.product = static_cast<int>(product->at(1));
+        }
+
+        devices.push_back(device);
+    }
+
+    XFreeDeviceList(infos);
+
+    return devices;
+}
+
+// the driver puts pressure on the third valuator
+std::optional<double> get_valuator_maximum(int deviceId, int number)
+{
+    auto* display = get_connection();
+
+    auto count = 0;
+    XIDeviceInfo* infos = nullptr;
+    if (!trap_x_errors(display, [&] { infos = XIQueryDevice(display, deviceId, &count); }) || infos == nullptr) return std::nullopt;
+
+    std::optional<double> maximum {};
+
+    for (auto const* info : std::span(infos->classes, static_cast<size_t>(infos->num_classes)))
+    {
+        if (info->type != XIValuatorClass) continue;
+
+        auto const* valuator = reinterpret_cast<XIValuatorClassInfo const*>(info);
+        if (valuator->number == number) maximum = valuator->max;
+    }
+
+    XIFreeDeviceInfo(infos);
+
+    return maximum;
+}
+
+unsigned long get_property_atom(std::string_view name)
+{
+    return XInternAtom(get_connection(), std::string(name).data(), False);
+}
+
+long encode_float_property(float value)
+{
+    return static_cast<long>(std::bit_cast<std::uint32_t>(value));
+}
+
+float decode_float_property(long value)
+{
+    return std::bit_cast<float>(static_cast<std::uint32_t>(value));
+}
+
+PropertyWrite make_float_write(int deviceId, std::string_view property, std::span<float const> values)
+{
+    PropertyWrite write { deviceId, get_property_atom(property), get_property_atom("FLOAT"), {} };
+    std::ranges::transform(values, std::back_inserter(write.values), encode_float_property);
+    return write;
+}
+
+// the root window always spans every monitor, and unlike the cached screen size it's current after a
+// RandR change even on a connection that never reads its events
+Region query_screen_region()
+{
+    auto* display = get_connection();
+
+    Window root = None;
+    auto x = 0;
+    auto y = 0;
+    auto width = 0u;
+    auto height = 0u;
+    auto border = 0u;
+    auto depth = 0u;
+    XGetGeometry(display, DefaultRootWindow(display), &root, &x, &y, &width, &height, &border, &depth);
+
+    return { 0, 0, static_cast<int>(width), static_cast<int>(height) };
+}
+
+// one round trip for the whole batch, so everything is in effect once this returns
+bool write_device_properties(std::span<PropertyWrite const> writes)
+{
+    auto* display = get_connection();
+
+    return trap_x_errors(display, [&] {
+        for (auto const& [deviceId, property, type, values] : writes)
+        {
+            // format 32 data is passed as an array of long, same as it comes back from XIGetProperty
+            auto* data = reinterpret_cast<unsigned char*>(const_cast<long*>(values.data()));
+            XIChangeProperty(display, deviceId, property, type, 32, PropModeReplace, data, static_cast<int>(values.size()));
+        }
+    });
+}
+
+// the driver's properties are all short, a single request always gets the whole thing
+std::optional<PropertyValues> read_device_property(int deviceId, unsigned long property)
+{
+    auto* display = get_connection();
+
+    Atom type {};
+    int format {};
+    unsigned long count {};
+    unsigned long remaining {};
+    unsigned char* data {};
+
+    auto status = Success;
+    auto const trapped = trap_x_errors(display, [&] {
+        status = XIGetProperty(display, deviceId, property, 0, 64, False, AnyPropertyType, &type, &format, &count, &remaining, &data);
+    });
+    if (!trapped || status != Success) return std::nullopt;
+
+    std::optional<PropertyValues> values {};
+
+    if (type != None && format == 32)
+    {
+        auto const* first = reinterpret_cast<long const*>(data);
+        values = PropertyValues { type, std::vector<long>(first, first + count) };
+    }
+
+    XFree(data);
+
+    return values;
+}
+
+PropertyWatcher open_property_watcher()
+{
+    PropertyWatcher watcher {};
+
+    watcher.display = XOpenDisplay(nullptr);
+    assert(watcher.display && "COULD NOT OPEN X DISPLAY");
+
+    auto event = 0;
+    auto error = 0;
+    [[maybe_unused]] auto const hasXInput = XQueryExtension(watcher.display, "XInputExtension", &watcher.opcode, &event, &error);
+    assert(hasXInput && "XINPUT EXTENSION IS UNAVAILABLE");
+
+    auto major = 2;
+    auto minor = 0;
+    [[maybe_unused]] auto const version = XIQueryVersion(watcher.display, &major, &minor);
+    assert(version == Success && "XINPUT 2 IS UNAVAILABLE");
+
+    watcher.areaAtom = XInternAtom(watcher.display, std::string(AREA_PROPERTY.property).data(), False);
+    watcher.pressureAtom = XInternAtom(watcher.display, std::string(PRESSURE_CURVE_PROPERTY.property).data(), False);
+
+    return watcher;
+}
+
+void close_property_watcher(PropertyWatcher& watcher)
+{
+    if (watcher.display != nullptr) XCloseDisplay(watcher.display);
+    watcher.display = nullptr;
+}
+
+void watch_device_properties(PropertyWatcher& watcher, std::span<Device const> devices)
+{
+    std::vector<std::array<unsigned char, XIMaskLen(XI_PropertyEvent)>> bits(devices.size());
+    std::vector<XIEventMask> masks {};
+
+    for (auto i = 0zu; i < devices.size(); i += 1)
+    {
+        XISetMask(bits.at(i).data(), XI_PropertyEvent);
+        masks.push_back({ devices[i].id, static_cast<int>(bits.at(i).size()), bits.at(i).data() });
+    }
+
+    // an id that went stale in the meantime fails the whole selection, the list is refreshed soon enough
+    trap_x_errors(watcher.display, [&] {
+        XISelectEvents(watcher.display, DefaultRootWindow(watcher.display), masks.data(), static_cast<int>(masks.size()));
+    });
+}
+
+std::vector<PropertyChange> poll_property_changes(PropertyWatcher& watcher)
+{
+    std::vector<PropertyChange> changes {};
+
+    while (XPending(watcher.display))
+    {
+        XEvent event {};
+        XNextEvent(watcher.display, &event);
+
+        auto& cookie = event.xcookie;
+        if (cookie.type != GenericEvent || cookie.extension != watcher.opcode || !XGetEventData(watcher.display, &cookie)) continue;
+
+        if (cookie.evtype == XI_PropertyEvent)
+        {
+            auto const* propertyEvent = static_cast<XIPropertyEvent const*>(cookie.data);
+            auto const deviceId = propertyEvent->deviceid;
+            auto const property = propertyEvent->property;
+
+            // several writes in a row are folded into a single change per device
+            auto change = std::ranges::find(changes, deviceId, &PropertyChange::deviceId);
+            if (change == changes.end()) change = changes.insert(changes.end(), { deviceId, std::nullopt, std::nullopt });
+
+            if (property == watcher.areaAtom)
+            {
+                if (auto const values = get_integer_property<4>(watcher.display, deviceId, property))
+                {
+                    auto const [x1, y1, x2, y2] = *values;
+                    change->area = Region { static_cast<int>(x1), static_cast<int>(y1), static_cast<int>(x2), static_cast<int>(y2) };
+                }
+            }
+            else if (property == watcher.pressureAtom)
+            {
+                if (auto const values = get_integer_property<4>(watcher.display, deviceId, property))
+                {
+                    auto const [minX, minY, maxX, maxY] = *values;
+                    change->pressure = Pressure {
+                        static_cast<float>(minX) / 100.f, static_cast<float>(minY) / 100.f,
+                        static_cast<float>(maxX) / 100.f, static_cast<float>(maxY) / 100.f
+                    };
+                }
+            }
+        }
+
+        XFreeEventData(watcher.display, &cookie);
+    }
+
+    std::erase_if(changes, [] (auto&& change) { return !change.area && !change.pressure; });
+
+    return changes;
+}
+
+int get_property_watcher_fd(PropertyWatcher const& watcher)
+{
+    return ConnectionNumber(watcher.display);
+}
+
+MotionWatcher open_motion_watcher(int deviceId)
+{
+    MotionWatcher watcher {};
+
+    watcher.display = XOpenDisplay(nullptr);
+    assert(watcher.display && "COULD NOT OPEN X DISPLAY");
+
+    auto event = 0;
+    auto error = 0;
+    [[maybe_unused]] auto const hasXInput = XQueryExtension(watcher.display, "XInputExtension", &watcher.opcode, &event, &error);
+    assert(hasXInput && "XINPUT EXTENSION IS UNAVAILABLE");
+
+    auto major = 2;
+    auto minor = 1;
+    [[maybe_unused]] auto const version = XIQueryVersion(watcher.display, &major, &minor);
+    assert(version == Success && "XINPUT 2.1 IS UNAVAILABLE");
+
+    // raw events of a slave device, which carry what the driver posted before the server scales it to the
+    // screen, and come through even while another client grabs the device
+    std::array<unsigned char, XIMaskLen(XI_RawMotion)> bits {};
+    XISetMask(bits.data(), XI_RawMotion);
+    XIEventMask mask { deviceId, static_cast<int>(bits.size()), bits.data() };
+    trap_x_errors(watcher.display, [&] { XISelectEvents(watcher.display, DefaultRootWindow(watcher.display), &mask, 1); });
+
+    return watcher;
+}
+
+void close_motion_watcher(MotionWatcher& watcher)
+{
+    if (watcher.display != nullptr) XCloseDisplay(watcher.display);
+    watcher.display = nullptr;
+}
+
+static std::int64_t get_clock_microseconds(clockid_t clock)
+{
+    timespec time {};
+    clock_gettime(clock, &time);
+    return time.tv_sec * 1'000'000 + time.tv_nsec / 1'000;
+}
+
+// X Time is the monotonic clock in milliseconds cut down to 32 bits, which wraps after 49.7 days. an event is
+// never more than a few seconds away from now, so its distance to now, taken modulo 2^32, puts it back in place
+static constexpr std::int64_t unwrap_server_time(std::uint32_t time, std::int64_t now)
+{
+    return now - static_cast<std::int32_t>(static_cast<std::uint32_t>(now) - time);
+}
+
+static_assert(unwrap_server_time(5, (1ll << 32) + 10) == (1ll << 32) + 5);
+static_assert(unwrap_server_time(0xffff'fff0u, (1ll << 32) + 10) == (1ll << 32) - 16);
+static_assert(unwrap_server_time(20, 10) == 20);
+
+std::vector<RawMotion> poll_raw_motion(MotionWatcher& watcher)
+{
+    std::vector<RawMotion> motions {};
+
+    // the server stamps events in milliseconds of the monotonic clock, evdev in the realtime one
+    auto const monotonic = get_clock_microseconds(CLOCK_MONOTONIC);
+    auto const clockOffset = get_clock_microseconds(CLOCK_REALTIME) - monotonic;
+
+    while (XPending(watcher.display))
+    {
+        XEvent event {};
+        XNextEvent(watcher.display, &event);
+
+        auto& cookie = event.xcookie;
+        if (cookie.type != GenericEvent || cookie.extension != watcher.opcode || !XGetEventData(watcher.display, &cookie)) continue;
+
+        if (cookie.evtype == XI_RawMotion)
+        {
+            auto const* raw = static_cast<XIRawEvent const*>(cookie.data);
+            auto hasPosition = false;
+
+            // only the valuators that changed are sent, packed in the order of the mask
+            auto const* value = raw->raw_values;
+            for (auto axis = 0; axis < raw->valuators.mask_len * 8 && axis < 2; axis += 1)
+            {
+                if (!XIMaskIsSet(raw->valuators.mask, axis)) continue;
+                (axis == 0 ? watcher.x : watcher.y) = *value++;
+                hasPosition = true;
+            }
+
+            if (hasPosition)
+            {
+                auto const time = unwrap_server_time(static_cast<std::uint32_t>(raw->time), monotonic / 1'000);
+                motions.push_back({ time * 1'000 + clockOffset, watcher.x, watcher.y });
+            }
+        }
+
+        XFreeEventData(watcher.display, &cookie);
+    }
+
+    return motions;
+}
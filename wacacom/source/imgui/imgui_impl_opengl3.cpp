@@ -22,6 +22,8 @@
 
 // CHANGELOG
 // (minor and older changes stripped away, please see git history for details)
+//  (local) OpenGL: Added ImGui_ImplOpenGL3_SetDamageRects() to redraw parts of a retained framebuffer.
+//  (local) OpenGL: Added opt-in ImGui_ImplOpenGL3_SetUploadMode() with orphaned and persistently mapped streaming buffers, one upload per frame.
 //  2024-10-07: OpenGL: Changed default texture sampler to Clamp instead of Repeat/Wrap.
 //  2024-06-28: OpenGL: ImGui_ImplOpenGL3_NewFrame() recreates font texture if it has been destroyed by ImGui_ImplOpenGL3_DestroyFontsTexture(). (#7748)
 //  2024-05-07: OpenGL: Update loader for Linux to support EGL/GLVND. (#7562)
@@ -208,6 +210,14 @@
 #define IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
 #endif
 
+// Desktop GL 3.2+ has fences and base vertex draws, which is what the streaming upload modes are built on
+#if defined(IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET)
+#define IMGUI_IMPL_OPENGL_MAY_STREAM
+#endif
+
+// Regions of the persistently mapped ring. A region is only written again once the fence placed after drawing from it signals.
+#define IMGUI_IMPL_OPENGL_STREAM_FRAMES 3
+
 // [Debugging]
 //#define IMGUI_IMPL_OPENGL_DEBUG
 #ifdef IMGUI_IMPL_OPENGL_DEBUG
@@ -238,7 +248,19 @@ struct ImGui_ImplOpenGL3_Data
     GLsizeiptr      IndexBufferSize;
     bool            HasPolygonMode;
     bool            HasClipOrigin;
+    bool            HasBufferStorage;
     bool            UseBufferSubData;
+    ImGui_ImplOpenGL3_UploadMode UploadMode;
+    ImVector<ImVec4> DamageRects;            // Empty when the whole framebuffer is drawn
+#ifdef IMGUI_IMPL_OPENGL_MAY_STREAM
+    GLuint          StreamVboHandle, StreamElementsHandle;
+    GLsizeiptr      StreamVertexBufferSize;  // Whole buffer when orphaning, one region of the ring when persistently mapped
+    GLsizeiptr      StreamIndexBufferSize;
+    char*           StreamVertexMapped;
+    char*           StreamIndexMapped;
+    GLsync          StreamFences[IMGUI_IMPL_OPENGL_STREAM_FRAMES];
+    int             StreamFrame;
+#endif
 
     ImGui_ImplOpenGL3_Data() { memset((void*)this, 0, sizeof(*this)); }
 };
@@ -379,8 +401,12 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
         const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
         if (extension != nullptr && strcmp(extension, "GL_ARB_clip_control") == 0)
             bd->HasClipOrigin = true;
+        if (extension != nullptr && strcmp(extension, "GL_ARB_buffer_storage") == 0)
+            bd->HasBufferStorage = true;
     }
 #endif
+    if (bd->GlVersion >= 440 && !bd->GlProfileIsES3)
+        bd->HasBufferStorage = true;
 
     return true;
 }
@@ -473,8 +499,18 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
 #endif
 
     // Bind vertex/index buffers and setup attributes for ImDrawVert
-    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, bd->VboHandle));
-    GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->ElementsHandle));
+#ifdef IMGUI_IMPL_OPENGL_MAY_STREAM
+    if (bd->UploadMode != ImGui_ImplOpenGL3_UploadMode_PerList)
+    {
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, bd->StreamVboHandle));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->StreamElementsHandle));
+    }
+    else
+#endif
+    {
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, bd->VboHandle));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->ElementsHandle));
+    }
     GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxPos));
     GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxUV));
     GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxColor));
@@ -483,6 +519,148 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
     GL_CALL(glVertexAttribPointer(bd->AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)offsetof(ImDrawVert, col)));
 }
 
+#ifdef IMGUI_IMPL_OPENGL_MAY_STREAM
+static void ImGui_ImplOpenGL3_DestroyStreamBuffers()
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    // Deleting a buffer unmaps it, and the driver keeps its storage alive for as long as queued draws still read from it
+    if (bd->StreamVboHandle)      { glDeleteBuffers(1, &bd->StreamVboHandle); bd->StreamVboHandle = 0; }
+    if (bd->StreamElementsHandle) { glDeleteBuffers(1, &bd->StreamElementsHandle); bd->StreamElementsHandle = 0; }
+    for (GLsync& fence : bd->StreamFences)
+        if (fence) { glDeleteSync(fence); fence = nullptr; }
+    bd->StreamVertexBufferSize = bd->StreamIndexBufferSize = 0;
+    bd->StreamVertexMapped = bd->StreamIndexMapped = nullptr;
+    bd->StreamFrame = 0;
+}
+
+// Writes the vertices and indices of every draw list back to back, with the byte offsets of where this frame's data starts.
+// Returns true when the buffers were recreated (or the mode fell back), so the caller has to bind them again.
+static bool ImGui_ImplOpenGL3_UploadStreamed(ImDrawData* draw_data, GLintptr* vtx_offset, GLintptr* idx_offset)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    const bool persistent = (bd->UploadMode == ImGui_ImplOpenGL3_UploadMode_Persistent);
+    const GLsizeiptr vtx_size = (GLsizeiptr)draw_data->TotalVtxCount * (int)sizeof(ImDrawVert);
+    const GLsizeiptr idx_size = (GLsizeiptr)draw_data->TotalIdxCount * (int)sizeof(ImDrawIdx);
+    *vtx_offset = *idx_offset = 0;
+
+    bool recreated = false;
+    if (bd->StreamVboHandle == 0 || vtx_size > bd->StreamVertexBufferSize || idx_size > bd->StreamIndexBufferSize)
+    {
+        // Grow with headroom so a window that gets a little busier doesn't reallocate every frame. Sizes stay whole
+        // vertices/indices so region offsets can be turned into base vertices.
+        ImGui_ImplOpenGL3_DestroyStreamBuffers();
+        const int vtx_count = draw_data->TotalVtxCount + draw_data->TotalVtxCount / 2;
+        const int idx_count = draw_data->TotalIdxCount + draw_data->TotalIdxCount / 2;
+        bd->StreamVertexBufferSize = (GLsizeiptr)(vtx_count > 4096 ? vtx_count : 4096) * (int)sizeof(ImDrawVert);
+        bd->StreamIndexBufferSize = (GLsizeiptr)(idx_count > 8192 ? idx_count : 8192) * (int)sizeof(ImDrawIdx);
+        glGenBuffers(1, &bd->StreamVboHandle);
+        glGenBuffers(1, &bd->StreamElementsHandle);
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, bd->StreamVboHandle));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->StreamElementsHandle));
+        if (persistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GL_CALL(glBufferStorage(GL_ARRAY_BUFFER, bd->StreamVertexBufferSize * IMGUI_IMPL_OPENGL_STREAM_FRAMES, nullptr, flags));
+            GL_CALL(glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, bd->StreamIndexBufferSize * IMGUI_IMPL_OPENGL_STREAM_FRAMES, nullptr, flags));
+            bd->StreamVertexMapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bd->StreamVertexBufferSize * IMGUI_IMPL_OPENGL_STREAM_FRAMES, flags);
+            bd->StreamIndexMapped = (char*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, bd->StreamIndexBufferSize * IMGUI_IMPL_OPENGL_STREAM_FRAMES, flags);
+            if (bd->StreamVertexMapped == nullptr || bd->StreamIndexMapped == nullptr)
+            {
+                ImGui_ImplOpenGL3_DestroyStreamBuffers();
+                bd->UploadMode = ImGui_ImplOpenGL3_UploadMode_Orphaned;
+                ImGui_ImplOpenGL3_UploadStreamed(draw_data, vtx_offset, idx_offset);
+                return true;
+            }
+        }
+        recreated = true;
+    }
+    else
+    {
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, bd->StreamVboHandle));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->StreamElementsHandle));
+    }
+
+    if (vtx_size == 0 || idx_size == 0)
+        return recreated;
+
+    char* vtx_dst;
+    char* idx_dst;
+    if (persistent)
+    {
+        // Wait for the GPU to be done with what was drawn from this region IMGUI_IMPL_OPENGL_STREAM_FRAMES frames ago
+        const int region = bd->StreamFrame % IMGUI_IMPL_OPENGL_STREAM_FRAMES;
+        if (GLsync fence = bd->StreamFences[region])
+        {
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+            glDeleteSync(fence);
+            bd->StreamFences[region] = nullptr;
+        }
+        *vtx_offset = region * bd->StreamVertexBufferSize;
+        *idx_offset = region * bd->StreamIndexBufferSize;
+        vtx_dst = bd->StreamVertexMapped + *vtx_offset;
+        idx_dst = bd->StreamIndexMapped + *idx_offset;
+    }
+    else
+    {
+        // Orphaning hands out fresh storage while the GPU may still be reading the previous frame's
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, bd->StreamVertexBufferSize, nullptr, GL_STREAM_DRAW));
+        GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, bd->StreamIndexBufferSize, nullptr, GL_STREAM_DRAW));
+        vtx_dst = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, vtx_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        idx_dst = (char*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, idx_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (vtx_dst == nullptr || idx_dst == nullptr)
+        {
+            if (vtx_dst) glUnmapBuffer(GL_ARRAY_BUFFER);
+            if (idx_dst) glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+            ImGui_ImplOpenGL3_DestroyStreamBuffers();
+            bd->UploadMode = ImGui_ImplOpenGL3_UploadMode_PerList;
+            return true;
+        }
+    }
+
+    for (const ImDrawList* draw_list : draw_data->CmdLists)
+    {
+        memcpy(vtx_dst, draw_list->VtxBuffer.Data, (size_t)draw_list->VtxBuffer.Size * sizeof(ImDrawVert));
+        memcpy(idx_dst, draw_list->IdxBuffer.Data, (size_t)draw_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+        vtx_dst += draw_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        idx_dst += draw_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+    }
+
+    if (!persistent)
+    {
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+    }
+    return recreated;
+}
+#endif
+
+ImGui_ImplOpenGL3_UploadMode ImGui_ImplOpenGL3_SetUploadMode(ImGui_ImplOpenGL3_UploadMode mode)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != nullptr && "Context or backend not initialized! Did you call ImGui_ImplOpenGL3_Init()?");
+#ifdef IMGUI_IMPL_OPENGL_MAY_STREAM
+    if (bd->GlVersion < 320 || bd->GlProfileIsES3)
+        mode = ImGui_ImplOpenGL3_UploadMode_PerList;
+    if (mode == ImGui_ImplOpenGL3_UploadMode_Persistent && !bd->HasBufferStorage)
+        mode = ImGui_ImplOpenGL3_UploadMode_Orphaned;
+    if (mode != bd->UploadMode)
+        ImGui_ImplOpenGL3_DestroyStreamBuffers();
+#else
+    mode = ImGui_ImplOpenGL3_UploadMode_PerList;
+#endif
+    bd->UploadMode = mode;
+    return mode;
+}
+
+void ImGui_ImplOpenGL3_SetDamageRects(const ImVec4* rects, int count)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != nullptr && "Context or backend not initialized! Did you call ImGui_ImplOpenGL3_Init()?");
+    bd->DamageRects.resize(count);
+    if (count > 0)
+        memcpy(bd->DamageRects.Data, rects, (size_t)count * sizeof(ImVec4));
+}
+
 // OpenGL3 Render function.
 // Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly.
 // This is in order to be able to run within an OpenGL engine that doesn't do so.
@@ -544,6 +722,18 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 #endif
     ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
 
+    // Streaming modes upload every list at once, draws then offset into that frame's data
+    GLintptr stream_vtx_offset = 0;
+    GLintptr stream_idx_offset = 0;
+#ifdef IMGUI_IMPL_OPENGL_MAY_STREAM
+    if (bd->UploadMode != ImGui_ImplOpenGL3_UploadMode_PerList)
+        if (ImGui_ImplOpenGL3_UploadStreamed(draw_data, &stream_vtx_offset, &stream_idx_offset))
+            ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
+#endif
+    const bool streamed = (bd->UploadMode != ImGui_ImplOpenGL3_UploadMode_PerList);
+    GLint list_vtx_base = (GLint)(stream_vtx_offset / (GLintptr)sizeof(ImDrawVert));
+    GLintptr list_idx_offset = stream_idx_offset;
+
     // Will project scissor/clipping rectangles into framebuffer space
     ImVec2 clip_off = draw_data->DisplayPos;         // (0,0) unless using multi-viewports
     ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
@@ -563,7 +753,11 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
         // - See https://github.com/ocornut/imgui/issues/4468 and please report any corruption issues.
         const GLsizeiptr vtx_buffer_size = (GLsizeiptr)draw_list->VtxBuffer.Size * (int)sizeof(ImDrawVert);
         const GLsizeiptr idx_buffer_size = (GLsizeiptr)draw_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx);
-        if (bd->UseBufferSubData)
+        if (streamed)
+        {
+            // Already uploaded along with every other list
+        }
+        else if (bd->UseBufferSubData)
         {
             if (bd->VertexBufferSize < vtx_buffer_size)
             {
@@ -604,21 +798,55 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
                 if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y)
                     continue;
 
-                // Apply scissor/clipping rectangle (Y is inverted in OpenGL)
-                GL_CALL(glScissor((int)clip_min.x, (int)((float)fb_height - clip_max.y), (int)(clip_max.x - clip_min.x), (int)(clip_max.y - clip_min.y)));
-
-                // Bind texture, Draw
+                // Bind texture
                 GL_CALL(glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->GetTexID()));
+
+                // Draw once per damage rectangle the command overlaps, or just once when there are none
+                const int damage_count = bd->DamageRects.Size;
+                for (int damage_n = 0; damage_n < (damage_count > 0 ? damage_count : 1); damage_n++)
+                {
+                    ImVec2 draw_min = clip_min;
+                    ImVec2 draw_max = clip_max;
+                    if (damage_count > 0)
+                    {
+                        const ImVec4& damage = bd->DamageRects[damage_n];
+                        draw_min = ImVec2(draw_min.x > damage.x ? draw_min.x : damage.x, draw_min.y > damage.y ? draw_min.y : damage.y);
+                        draw_max = ImVec2(draw_max.x < damage.z ? draw_max.x : damage.z, draw_max.y < damage.w ? draw_max.y : damage.w);
+                        if (draw_max.x <= draw_min.x || draw_max.y <= draw_min.y)
+                            continue;
+                    }
+
+                    // Apply scissor/clipping rectangle (Y is inverted in OpenGL)
+                    GL_CALL(glScissor((int)draw_min.x, (int)((float)fb_height - draw_max.y), (int)(draw_max.x - draw_min.x), (int)(draw_max.y - draw_min.y)));
+
 #ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
-                if (bd->GlVersion >= 320)
-                    GL_CALL(glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)), (GLint)pcmd->VtxOffset));
-                else
+                    if (bd->GlVersion >= 320)
+                        GL_CALL(glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(list_idx_offset + pcmd->IdxOffset * sizeof(ImDrawIdx)), list_vtx_base + (GLint)pcmd->VtxOffset));
+                    else
 #endif
-                GL_CALL(glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx))));
+                    GL_CALL(glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx))));
+                }
             }
         }
+
+        if (streamed)
+        {
+            list_vtx_base += draw_list->VtxBuffer.Size;
+            list_idx_offset += idx_buffer_size;
+        }
     }
 
+#ifdef IMGUI_IMPL_OPENGL_MAY_STREAM
+    // Fence what was drawn from this region of the ring, it's written again IMGUI_IMPL_OPENGL_STREAM_FRAMES frames from now
+    if (bd->UploadMode == ImGui_ImplOpenGL3_UploadMode_Persistent && bd->StreamVboHandle != 0)
+    {
+        const int region = bd->StreamFrame % IMGUI_IMPL_OPENGL_STREAM_FRAMES;
+        if (bd->StreamFences[region] == nullptr)
+            bd->StreamFences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        bd->StreamFrame++;
+    }
+#endif
+
     // Destroy the temporary VAO
 #ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
     GL_CALL(glDeleteVertexArrays(1, &vertex_array_object));
@@ -950,6 +1178,9 @@ void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
     ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
     if (bd->VboHandle)      { glDeleteBuffers(1, &bd->VboHandle); bd->VboHandle = 0; }
     if (bd->ElementsHandle) { glDeleteBuffers(1, &bd->ElementsHandle); bd->ElementsHandle = 0; }
+#ifdef IMGUI_IMPL_OPENGL_MAY_STREAM
+    ImGui_ImplOpenGL3_DestroyStreamBuffers();
+#endif
     if (bd->ShaderHandle)   { glDeleteProgram(bd->ShaderHandle); bd->ShaderHandle = 0; }
     ImGui_ImplOpenGL3_DestroyFontsTexture();
 }